@@ -0,0 +1,21 @@
+#ifndef _COMBOS_H_
+#define _COMBOS_H_
+
+#include <stdint.h>
+
+#include "../firmware_config.h"
+#include "../keycodes.h"
+#include "keyboard.h"
+
+/*
+ * Combos, keys pressed together within COMBO_TERM send one code instead.
+ * Each line is the code followed by up to COMBO_KEY_MAX key indexes of MATRIX_DEFINE, keys of both halves can be
+ * mixed. Codes are the same as in keymap.h and do not depend on the active layer.
+ */
+static const uint32_t COMBOS[][COMBO_KEY_MAX + 1] = {
+    // {KC_CAPS, 19, 24} // F + J.
+};
+
+#define COMBO_NUM (sizeof(COMBOS) / sizeof(COMBOS[0]))
+
+#endif
@@ -28,8 +28,13 @@
 #define MATRIX_ROW_NUM 4
 #define MATRIX_COL_NUM 7
 
-#define MATRIX_ROW_PINS {C6, D7, E6, B4}
-#define MATRIX_COL_PINS {F5, F6, F7, B1, B3, B2, B6}
+#define MATRIX_ROW_PIN_LIST C6, D7, E6, B4
+#define MATRIX_COL_PIN_LIST F5, F6, F7, B1, B3, B2, B6
+
+#define MATRIX_ROW_PINS {MATRIX_ROW_PIN_LIST}
+#define MATRIX_COL_PINS {MATRIX_COL_PIN_LIST}
+
+#define MATRIX_GHOST_MODE MATRIX_GHOST_NONE // Every key has a diode.
 
 // Master keyboard definition.
 #ifdef MASTER
@@ -0,0 +1,224 @@
+#include "combo.h"
+
+#include <string.h>
+
+#include "../port/port.h"
+
+#define TICKS_MASK  0x00FFFFFF // Event clock is 24 bits, as the RTC counter.
+#define COMBO_WORDS ((COMBO_NUM_MAX + 31) / 32)
+
+STATIC_ASSERT(COMBO_NUM_MAX < 256);
+
+static combo_evt_handler_t m_evt_handler;
+static uint32_t const (*m_combos)[COMBO_KEY_MAX + 1];
+static uint32_t m_term; // COMBO_TERM in ticks.
+
+static uint32_t m_members[KEY_INDEX_MAX + 1][COMBO_WORDS]; // Combos each key is part of.
+static uint8_t m_sizes[COMBO_NUM_MAX];                      // Key count of each combo.
+
+// Held back presses.
+static key_event_t m_held[COMBO_KEY_MAX];
+static uint8_t m_held_count;
+static uint32_t m_candidates[COMBO_WORDS]; // Combos with every held back key in them.
+
+// Combos down.
+static uint8_t m_key_combo[KEY_INDEX_MAX + 1]; // Combo index + 1 each key is down for, 0 if none.
+static int8_t m_combo_carrier[COMBO_NUM_MAX];  // Key index the press of each combo went on, 0 if combo is up.
+
+static bool window_passed(uint32_t now) {
+    return ((now - m_held[0].timestamp) & TICKS_MASK) >= m_term;
+}
+
+// Candidate with exactly the held back keys, or -1. Candidates have every held back key, so same size is same keys.
+static int exact_get(uint8_t *p_candidate_count) {
+    int exact = -1;
+
+    *p_candidate_count = 0;
+
+    for (int word = 0; word < COMBO_WORDS; word++) {
+        uint32_t bits = m_candidates[word];
+
+        *p_candidate_count += __builtin_popcount(bits);
+
+        while (bits != 0 && exact < 0) {
+            int combo = word * 32 + __builtin_ctz(bits);
+
+            bits &= bits - 1;
+
+            if (m_sizes[combo] == m_held_count) {
+                exact = combo;
+            }
+        }
+    }
+
+    return exact;
+}
+
+static void fire(int combo) {
+    // Combo goes on the first key, at the time of the press that completed it.
+    key_event_t event = m_held[m_held_count - 1];
+
+    event.key_index = m_held[0].key_index;
+    event.combo = combo + 1;
+
+    for (int i = 0; i < m_held_count; i++) {
+        m_key_combo[m_held[i].key_index] = combo + 1;
+    }
+
+    m_combo_carrier[combo] = event.key_index;
+    m_held_count = 0;
+
+    m_evt_handler(&event);
+}
+
+// Held back presses are a combo if one has exactly these keys, otherwise they go on as they were.
+static void held_decide(void) {
+    uint8_t candidate_count;
+    int combo = exact_get(&candidate_count);
+
+    if (combo >= 0) {
+        fire(combo);
+        return;
+    }
+
+    for (int i = 0; i < m_held_count; i++) {
+        m_evt_handler(&m_held[i]);
+    }
+
+    m_held_count = 0;
+}
+
+// A combo can fire before its window ends once no longer combo is left.
+static void held_check(void) {
+    uint8_t candidate_count;
+    int combo = exact_get(&candidate_count);
+
+    if (combo >= 0 && candidate_count == 1) {
+        fire(combo);
+    }
+}
+
+static void release_process(key_event_t const *p_event) {
+    uint8_t combo = m_key_combo[p_event->key_index];
+
+    if (combo == 0) {
+        m_evt_handler(p_event);
+        return;
+    }
+
+    m_key_combo[p_event->key_index] = 0;
+
+    // First key let go releases the combo, the other keys are swallowed.
+    if (m_combo_carrier[combo - 1] != 0) {
+        key_event_t event = *p_event;
+
+        event.key_index = m_combo_carrier[combo - 1];
+        m_combo_carrier[combo - 1] = 0;
+
+        m_evt_handler(&event);
+    }
+}
+
+static bool press_hold(key_event_t const *p_event) {
+    uint32_t candidates[COMBO_WORDS];
+    uint32_t any = 0;
+
+    for (int word = 0; word < COMBO_WORDS; word++) {
+        candidates[word] = m_members[p_event->key_index][word];
+
+        if (m_held_count > 0) {
+            candidates[word] &= m_candidates[word];
+        }
+
+        any |= candidates[word];
+    }
+
+    if (any == 0 || m_held_count == COMBO_KEY_MAX) {
+        return false;
+    }
+
+    memcpy(m_candidates, candidates, sizeof(m_candidates));
+    m_held[m_held_count++] = *p_event;
+
+    held_check();
+
+    return true;
+}
+
+void combo_init(combo_init_t const *p_init) {
+    m_evt_handler = p_init->evt_handler;
+    m_combos = p_init->p_combos;
+    m_term = p_init->ticks_get(COMBO_TERM);
+
+    memset(m_members, 0, sizeof(m_members));
+    memset(m_sizes, 0, sizeof(m_sizes));
+    memset(m_key_combo, 0, sizeof(m_key_combo));
+    memset(m_combo_carrier, 0, sizeof(m_combo_carrier));
+    m_held_count = 0;
+
+    uint16_t combo_num = MIN(p_init->combo_num, COMBO_NUM_MAX);
+
+    for (int combo = 0; combo < combo_num; combo++) {
+        for (int i = 1; i <= COMBO_KEY_MAX; i++) {
+            uint32_t key_index = m_combos[combo][i];
+
+            if (key_index < 1 || key_index > KEY_INDEX_MAX) {
+                continue;
+            }
+
+            m_members[key_index][combo / 32] |= 1UL << (combo % 32);
+            m_sizes[combo]++;
+        }
+    }
+}
+
+void combo_event_process(key_event_t const *p_event) {
+    if (m_held_count > 0 && window_passed(p_event->timestamp)) {
+        held_decide();
+    }
+
+    if (!p_event->pressed) {
+        // Any release ends the wait, a held back key let go completes its combo or breaks it.
+        if (m_held_count > 0) {
+            held_decide();
+        }
+
+        release_process(p_event);
+        return;
+    }
+
+    if (press_hold(p_event)) {
+        return;
+    }
+
+    // Key breaks the held back presses, it may start a new combo after them.
+    if (m_held_count > 0) {
+        held_decide();
+
+        if (press_hold(p_event)) {
+            return;
+        }
+    }
+
+    m_evt_handler(p_event);
+}
+
+void combo_tick(uint32_t now) {
+    if (m_held_count > 0 && window_passed(now)) {
+        held_decide();
+    }
+}
+
+bool combo_deadline_get(uint32_t *p_deadline) {
+    if (m_held_count == 0) {
+        return false;
+    }
+
+    *p_deadline = (m_held[0].timestamp + m_term) & TICKS_MASK;
+
+    return true;
+}
+
+uint32_t combo_code_get(uint8_t combo) {
+    return m_combos[combo - 1][0];
+}
@@ -0,0 +1,40 @@
+#ifndef _COMBO_H_
+#define _COMBO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../firmware_config.h"
+#include "../key_event/key_event.h"
+
+/*
+ * Combo engine, before the tap hold engine.
+ * Each key keeps a bitset of the combos it is part of. Presses of combo keys are held back while the AND of their
+ * bitsets still has a combo in it, so one press costs a word per 32 combos whatever the number of combos.
+ * A completed combo goes on as a press of its first key with combo set, a release of any of its keys releases it.
+ */
+
+// Presses and releases in order, held back presses come with their own time stamps.
+typedef void (*combo_evt_handler_t)(key_event_t const *p_event);
+
+typedef struct {
+    uint32_t const (*p_combos)[COMBO_KEY_MAX + 1]; // Code, then key indexes, see config/combos.h.
+    uint16_t combo_num;
+    combo_evt_handler_t evt_handler;
+    uint32_t (*ticks_get)(uint32_t ms); // Ticks of the event clock in ms, RTC ticks on target.
+} combo_init_t;
+
+void combo_init(combo_init_t const *p_init);
+
+void combo_event_process(key_event_t const *p_event);
+
+// Decide held back presses whose window ran out at now, in ticks of the event clock.
+void combo_tick(uint32_t now);
+
+// Returns false if no press is held back, else the tick its window runs out.
+bool combo_deadline_get(uint32_t *p_deadline);
+
+// Code of a combo, combo is the index + 1 from a key event.
+uint32_t combo_code_get(uint8_t combo);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef _COMBOS_H_
+#define _COMBOS_H_
+
+#include <stdint.h>
+
+#include "../firmware_config.h"
+#include "../keycodes.h"
+#include "keyboard.h"
+
+/*
+ * Combos, keys pressed together within COMBO_TERM send one code instead.
+ * Each line is the code followed by up to COMBO_KEY_MAX key indexes of MATRIX_DEFINE, keys of both halves can be
+ * mixed. Codes are the same as in keymap.h and do not depend on the active layer. The last line is an end marker,
+ * so the table is never empty, and is not a combo.
+ */
+static const uint32_t COMBOS[][COMBO_KEY_MAX + 1] = {
+    // {KC_CAPS, 19, 24}, // F + J.
+    {KC_NO}
+};
+
+#define COMBO_NUM (sizeof(COMBOS) / sizeof(COMBOS[0]) - 1)
+
+#endif
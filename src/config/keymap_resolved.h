@@ -0,0 +1,63 @@
+#ifndef _KEYMAP_RESOLVED_H_
+#define _KEYMAP_RESOLVED_H_
+
+// Generated by tools/keymap_resolve.c from keymap.h, do not edit.
+
+#include <stdint.h>
+
+#include "../keycodes.h"
+#include "keyboard.h"
+
+#define KEYMAP_LAYER_NUM 5
+
+// Resolved key codes in chunks of MATRIX_COL_NUM keys, identical chunks are stored once.
+const uint32_t KEYMAP_CHUNKS[][MATRIX_COL_NUM] = {
+    {0x002B, 0x0014, 0x001A, 0x0008, 0x0015, 0x0017, 0x0029},
+    {0x0000, 0x001C, 0x0018, 0x000C, 0x0012, 0x0013, 0x002A},
+    {0x0100, 0x0004, 0x0016, 0x0007, 0x0009, 0x000A, 0x080F},
+    {0x0000, 0x000B, 0x000D, 0x000E, 0x000F, 0x0033, 0x0034},
+    {0x0200, 0x001D, 0x001B, 0x0006, 0x0019, 0x0005, 0x0000},
+    {0x004C, 0x0011, 0x0010, 0x0036, 0x0037, 0x0038, 0x0028},
+    {0x0029, 0x00AD, 0x0800, 0x0400, 0x00AA, 0x002C, 0x0000},
+    {0x0000, 0x2000, 0x00AB, 0x4000, 0x8000, 0x004C, 0x0000},
+    {0x0235, 0x021E, 0x021F, 0x0220, 0x0221, 0x0222, 0x0000},
+    {0x0000, 0x0223, 0x0224, 0x0225, 0x002D, 0x002E, 0x0231},
+    {0x0035, 0x001E, 0x001F, 0x0020, 0x0021, 0x0022, 0x0000},
+    {0x0000, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0031},
+    {0x0200, 0x001D, 0x001B, 0x022F, 0x002F, 0x0226, 0x0000},
+    {0x004C, 0x0227, 0x0030, 0x0230, 0x022D, 0x022E, 0x0028},
+    {0x0000, 0x2000, 0x00AC, 0x4000, 0x8000, 0x004C, 0x0000},
+    {0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F, 0x0000},
+    {0x0000, 0x004B, 0x004E, 0x004A, 0x004D, 0x0049, 0x004C},
+    {0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0000},
+    {0x0000, 0x0050, 0x0051, 0x0052, 0x004F, 0x0046, 0x0048},
+    {0x004C, 0x0150, 0x014F, 0x0230, 0x022D, 0x022E, 0x0047},
+    {0x0029, 0x00AD, 0x0800, 0x0400, 0x00AC, 0x002C, 0x0000},
+    {0x0000, 0x0055, 0x005F, 0x0060, 0x0061, 0x0056, 0x0053},
+    {0x0039, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0000},
+    {0x0000, 0x0054, 0x005C, 0x005D, 0x005E, 0x0057, 0x0048},
+    {0x004C, 0x0062, 0x0059, 0x005A, 0x005B, 0x0063, 0x0058},
+    {0x00BA, 0x00CE, 0x003C, 0x003D, 0x00A8, 0x00A5, 0x0000},
+    {0x00BB, 0x00CF, 0x0042, 0x0043, 0x0044, 0x00A6, 0x0000},
+    {0x00B9, 0x001D, 0x001B, 0x022F, 0x002F, 0x00A7, 0x0000}
+};
+
+// Chunk of every part of each layer.
+const uint8_t KEYMAP_LAYER_CHUNKS[KEYMAP_LAYER_NUM][MATRIX_ROW_NUM * 2] = {
+    {0, 1, 2, 3, 4, 5, 6, 7},
+    {8, 9, 10, 11, 12, 13, 6, 14},
+    {15, 16, 17, 18, 12, 19, 20, 14},
+    {15, 21, 22, 23, 12, 24, 20, 14},
+    {25, 21, 26, 23, 27, 24, 20, 14}
+};
+
+// Resolved code of a key index, counted from 0. Layers that are not defined have no keys.
+static inline uint32_t keymap_code_get(uint8_t layer, uint8_t index) {
+    if (layer >= KEYMAP_LAYER_NUM) {
+        return 0;
+    }
+
+    return KEYMAP_CHUNKS[KEYMAP_LAYER_CHUNKS[layer][index / MATRIX_COL_NUM]][index % MATRIX_COL_NUM];
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef _MACROS_H_
+#define _MACROS_H_
+
+#include <stdint.h>
+
+#include "../keycodes.h"
+
+/*
+ * Macros, played by MACRO(index) keys of keymap.h.
+ * Each macro is a byte code string ending with MACRO_END, see macro_byte_codes in keycodes.h. Text can be written
+ * as a string literal, its terminating zero is MACRO_END. Text bytes with no keycode are skipped with a warning log.
+ */
+static const uint8_t MACRO_SELECT_ALL_COPY[] = {
+    MACRO_MODS, MOD_BIT(KC_LCTRL), MACRO_TAP, KC_A, MACRO_TAP, KC_C, MACRO_END
+};
+
+static const uint8_t MACRO_SIGNATURE[] = "Best regards,\n";
+
+static const uint8_t *const MACROS[] = {
+    MACRO_SELECT_ALL_COPY,
+    MACRO_SIGNATURE
+};
+
+#define MACRO_NUM (sizeof(MACROS) / sizeof(MACROS[0]))
+
+#endif
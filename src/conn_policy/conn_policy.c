@@ -0,0 +1,142 @@
+#include "conn_policy.h"
+
+#include <string.h>
+
+#include "../firmware_config.h"
+#include "../port/port.h"
+
+// Sup timeout must be over twice the time between events with latency, it is in 10 ms and intervals in 1.25 ms.
+STATIC_ASSERT((1 + CONN_IDLE_SLAVE_LATENCY) * CONN_IDLE_MAX_INTERVAL < CONN_SUP_TIMEOUT * 4);
+
+static const conn_policy_params_t POLICY_PARAMS[CONN_POLICY_NUM] = {
+    [CONN_POLICY_FAST] = {
+        .min_conn_interval = MASTER_MIN_CONN_INTERVAL,
+        .max_conn_interval = MASTER_MAX_CONN_INTERVAL,
+        .slave_latency = SLAVE_LATENCY,
+        .conn_sup_timeout = CONN_SUP_TIMEOUT
+    },
+    [CONN_POLICY_IDLE] = {
+        .min_conn_interval = CONN_IDLE_MIN_INTERVAL,
+        .max_conn_interval = CONN_IDLE_MAX_INTERVAL,
+        .slave_latency = CONN_IDLE_SLAVE_LATENCY,
+        .conn_sup_timeout = CONN_SUP_TIMEOUT
+    }
+};
+
+static conn_policy_init_t m_init;
+static bool m_connected = false;
+static conn_policy_t m_policy;    // Policy wanted.
+static conn_policy_t m_requested; // Policy of the last request taken.
+static uint32_t m_last_activity;
+static bool m_idle_timer_running = false;
+static conn_policy_stats_t m_stats;
+
+static void idle_timer_start(uint32_t ms) {
+    m_init.timer_start(ms);
+    m_idle_timer_running = true;
+}
+
+// A refused request is asked again on the next grant or report.
+static void request(void) {
+    if (!m_connected || m_policy == m_requested) {
+        return;
+    }
+
+    bool taken = m_init.params_request(&POLICY_PARAMS[m_policy]);
+
+    PORT_LOG_INFO("Conn policy; %s, taken: %d.", m_policy == CONN_POLICY_IDLE ? "idle" : "fast", taken);
+
+    if (taken) {
+        m_requested = m_policy;
+        m_stats.requests[m_policy]++;
+    } else {
+        m_stats.refused++;
+    }
+}
+
+void conn_policy_init(conn_policy_init_t const *p_init) {
+    m_init = *p_init;
+    m_connected = false;
+    m_idle_timer_running = false;
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.interval_fastest = UINT16_MAX;
+}
+
+void conn_policy_connected(conn_policy_params_t const *p_params) {
+    m_connected = true;
+
+    // Connections start on the parameters given at init.
+    m_policy = CONN_POLICY_FAST;
+    m_requested = CONN_POLICY_FAST;
+    m_last_activity = m_init.ms_get();
+
+    conn_policy_granted(p_params);
+
+    // A timer left from the last connection waits again for the quiet time left when it runs out.
+    if (!m_idle_timer_running) {
+        idle_timer_start(CONN_IDLE_TIMEOUT);
+    }
+}
+
+void conn_policy_disconnected(void) {
+    m_connected = false;
+}
+
+void conn_policy_granted(conn_policy_params_t const *p_params) {
+    m_stats.grants++;
+    m_stats.granted = *p_params;
+    m_stats.interval_fastest = MIN(m_stats.interval_fastest, p_params->max_conn_interval);
+    m_stats.interval_slowest = MAX(m_stats.interval_slowest, p_params->max_conn_interval);
+    m_stats.latency_max = MAX(m_stats.latency_max, p_params->slave_latency);
+
+    PORT_LOG_INFO("Conn policy granted; interval: %d, latency: %d, grants: %u.", p_params->max_conn_interval,
+                  p_params->slave_latency, m_stats.grants);
+
+    request();
+}
+
+void conn_policy_activity(void) {
+    if (!m_connected) {
+        return;
+    }
+
+    m_last_activity = m_init.ms_get();
+
+    if (m_policy == CONN_POLICY_IDLE) {
+        m_policy = CONN_POLICY_FAST;
+    }
+
+    request();
+
+    // The timer is not restarted on every report, it waits again for the quiet time left when it runs out.
+    if (!m_idle_timer_running) {
+        idle_timer_start(CONN_IDLE_TIMEOUT);
+    }
+}
+
+void conn_policy_timeout(void) {
+    m_idle_timer_running = false;
+
+    if (!m_connected) {
+        return;
+    }
+
+    uint32_t quiet = m_init.ms_get() - m_last_activity;
+
+    if (quiet < CONN_IDLE_TIMEOUT) {
+        idle_timer_start(CONN_IDLE_TIMEOUT - quiet);
+        return;
+    }
+
+    m_policy = CONN_POLICY_IDLE;
+    request();
+}
+
+conn_policy_t conn_policy_get(void) {
+    return m_policy;
+}
+
+void conn_policy_stats_get(conn_policy_stats_t *p_stats) {
+    memcpy(p_stats, &m_stats, sizeof(m_stats));
+}
@@ -0,0 +1,67 @@
+#ifndef _CONN_POLICY_H_
+#define _CONN_POLICY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Connection parameter policy of the host link.
+ * A link without reports for CONN_IDLE_TIMEOUT asks the host for the idle interval and slave latency, the next report
+ * asks for the fast parameters again and the host picks its fastest interval in that range. Slave latency only skips
+ * connection events with nothing to send, the SoftDevice wakes at the next one once a notification is queued.
+ *
+ * Requests go through the request callback, ble_conn_params on target, so it negotiates towards the parameters of the
+ * current policy and not back to the ones given at init. Time is uptime ms and the idle timer is the caller's, so a
+ * host build can drive the policy with a fake clock.
+ */
+
+typedef enum {
+    CONN_POLICY_FAST,
+    CONN_POLICY_IDLE,
+    CONN_POLICY_NUM
+} conn_policy_t;
+
+// Fields as in ble_gap_conn_params_t.
+typedef struct {
+    uint16_t min_conn_interval; // In 1.25 ms units.
+    uint16_t max_conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;  // In 10 ms units.
+} conn_policy_params_t;
+
+typedef struct {
+    uint32_t (*ms_get)(void);                                     // Uptime in ms.
+    bool (*params_request)(conn_policy_params_t const *p_params); // Returns false if the request is refused.
+    void (*timer_start)(uint32_t ms);                             // Single shot, conn_policy_timeout() when it runs out.
+} conn_policy_init_t;
+
+typedef struct {
+    uint32_t requests[CONN_POLICY_NUM]; // Requests taken for each policy.
+    uint32_t refused;                   // Requests refused, mostly while another update runs. Asked again later.
+    uint32_t grants;                    // Parameters set by the host, on connection and on every update.
+    conn_policy_params_t granted;       // Last granted, both intervals are the one in use.
+    uint16_t interval_fastest;          // Shortest and longest interval granted, in 1.25 ms units.
+    uint16_t interval_slowest;
+    uint16_t latency_max;
+} conn_policy_stats_t;
+
+void conn_policy_init(conn_policy_init_t const *p_init);
+
+void conn_policy_connected(conn_policy_params_t const *p_params);
+
+void conn_policy_disconnected(void);
+
+// Parameters from a BLE_GAP_EVT_CONN_PARAM_UPDATE of the link.
+void conn_policy_granted(conn_policy_params_t const *p_params);
+
+// A report is sent, the link leaves idle at once.
+void conn_policy_activity(void);
+
+// The timer started by timer_start ran out.
+void conn_policy_timeout(void);
+
+conn_policy_t conn_policy_get(void);
+
+void conn_policy_stats_get(conn_policy_stats_t *p_stats);
+
+#endif
@@ -0,0 +1,85 @@
+#include "cycle_stats.h"
+
+#if CYCLE_STATS_ENABLED
+
+#include <string.h>
+
+#include "../port/port.h"
+
+static const char *STAGE_NAMES[CYCLE_STATS_STAGE_NUM] = {"scan", "update", "translate", "generate"};
+
+static cycle_stats_source_t m_source;
+static cycle_stats_t m_stats[CYCLE_STATS_STAGE_NUM];
+
+void cycle_stats_init(cycle_stats_source_t source) {
+    if (source == NULL) {
+        PORT_CYCLE_COUNTER_START();
+        source = port_cycle_counter_get;
+    }
+
+    m_source = source;
+
+    memset(m_stats, 0, sizeof(m_stats));
+
+    for (int i = 0; i < CYCLE_STATS_STAGE_NUM; i++) {
+        m_stats[i].min = UINT32_MAX;
+    }
+}
+
+uint32_t cycle_stats_now(void) {
+    return m_source();
+}
+
+void cycle_stats_record(cycle_stats_stage_t stage, uint32_t cycles) {
+    cycle_stats_t *p_stats = &m_stats[stage];
+    uint8_t bin = (cycles == 0) ? 0 : 32 - PORT_CLZ(cycles);
+
+    if (bin >= CYCLE_STATS_HISTOGRAM_BINS) {
+        bin = CYCLE_STATS_HISTOGRAM_BINS - 1;
+    }
+
+    if (cycles < p_stats->min) {
+        p_stats->min = cycles;
+    }
+
+    if (cycles > p_stats->max) {
+        p_stats->max = cycles;
+    }
+
+    p_stats->count++;
+    p_stats->sum += cycles;
+
+    // Saturate instead of wrapping, so the shape of the histogram stays readable.
+    if (p_stats->histogram[bin] < UINT16_MAX) {
+        p_stats->histogram[bin]++;
+    }
+
+    if (stage == CYCLE_STATS_SCAN && p_stats->count % CYCLE_STATS_LOG_INTERVAL == 0) {
+        cycle_stats_log();
+    }
+}
+
+cycle_stats_t const *cycle_stats_get(cycle_stats_stage_t stage) {
+    return &m_stats[stage];
+}
+
+void cycle_stats_log(void) {
+    for (int i = 0; i < CYCLE_STATS_STAGE_NUM; i++) {
+        cycle_stats_t const *p_stats = &m_stats[i];
+
+        if (p_stats->count == 0) {
+            continue;
+        }
+
+        PORT_LOG_INFO("cycles %s; n: %u, min: %u, max: %u, mean: %u", STAGE_NAMES[i], p_stats->count, p_stats->min,
+                      p_stats->max, (uint32_t)(p_stats->sum / p_stats->count));
+
+        for (int bin = 0; bin < CYCLE_STATS_HISTOGRAM_BINS; bin++) {
+            if (p_stats->histogram[bin] > 0) {
+                PORT_LOG_INFO("cycles %s; < 2^%d: %d", STAGE_NAMES[i], bin, p_stats->histogram[bin]);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _CYCLE_STATS_H_
+#define _CYCLE_STATS_H_
+
+#include <stdint.h>
+
+#include "../firmware_config.h"
+
+/*
+ * Cycle counts of firmware stages.
+ * Enabled by CYCLE_STATS_ENABLED in firmware_config.h. When disabled, every macro below compiles to nothing.
+ * Per stage min, max, mean and a log2 histogram are kept in RAM and dumped to the logger.
+ */
+
+typedef enum {
+    CYCLE_STATS_SCAN,
+    CYCLE_STATS_UPDATE,
+    CYCLE_STATS_TRANSLATE,
+    CYCLE_STATS_GENERATE,
+    CYCLE_STATS_STAGE_NUM
+} cycle_stats_stage_t;
+
+// Returns a free running cycle count, wrapping at 32 bits.
+typedef uint32_t (*cycle_stats_source_t)(void);
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint32_t count;
+    uint64_t sum;
+    uint16_t histogram[CYCLE_STATS_HISTOGRAM_BINS]; // Bin n counts cycles in [2^(n-1), 2^n), last bin takes the rest.
+} cycle_stats_t;
+
+#if CYCLE_STATS_ENABLED
+
+// Passing NULL uses the cycle counter of port.h, DWT on target. A fake source can be passed off target.
+void cycle_stats_init(cycle_stats_source_t source);
+uint32_t cycle_stats_now(void);
+void cycle_stats_record(cycle_stats_stage_t stage, uint32_t cycles);
+cycle_stats_t const *cycle_stats_get(cycle_stats_stage_t stage);
+void cycle_stats_log(void);
+
+#define CYCLE_STATS_INIT()               cycle_stats_init(NULL)
+#define CYCLE_STATS_BEGIN(_name)         uint32_t _name ## _cycle_start = cycle_stats_now()
+#define CYCLE_STATS_END(_name, _stage)   cycle_stats_record(_stage, cycle_stats_now() - _name ## _cycle_start)
+
+#else
+
+#define CYCLE_STATS_INIT()
+#define CYCLE_STATS_BEGIN(_name)
+#define CYCLE_STATS_END(_name, _stage)
+
+#endif
+
+#endif
@@ -1,8 +1,7 @@
 #ifndef _FIRMWARE_CONFIG_H_
 #define _FIRMWARE_CONFIG_H_
 
-#include "app_timer.h"
-#include "app_util.h"
+// SDK macros used below expand where they are used, so modules that also build on a host can include this file.
 
 // BLE parameters.
 #define APP_BLE_OBSERVER_PRIO 3 // Application's BLE observer priority. You shouldn't need to modify this value.
@@ -44,6 +43,12 @@
 #define NEXT_CONN_PARAMS_UPDATE_DELAY  APP_TIMER_TICKS(10000) // Time between each call to sd_ble_gap_conn_param_update after the first call (10 seconds).
 #define MAX_CONN_PARAMS_UPDATE_COUNT   5                      // Number of attempts before giving up the connection parameter negotiation.
 
+// Connection parameters asked for by the master once no report was sent for CONN_IDLE_TIMEOUT.
+#define CONN_IDLE_TIMEOUT       30000                           // In ms.
+#define CONN_IDLE_MIN_INTERVAL  MSEC_TO_UNITS(30, UNIT_1_25_MS) // Minimum idle connection interval.
+#define CONN_IDLE_MAX_INTERVAL  MSEC_TO_UNITS(50, UNIT_1_25_MS) // Maximum idle connection interval.
+#define CONN_IDLE_SLAVE_LATENCY 8                               // Quiet connection events skipped, 450 ms at most between events.
+
 // Peer manager parameters.
 #define SEC_PARAM_BOND            1                    // Perform bonding.
 #define SEC_PARAM_MITM            0                    // Man In The Middle protection not required.
@@ -55,7 +60,7 @@
 #define SEC_PARAM_MAX_KEY_SIZE    16                   // Maximum encryption key size.
 
 // HID report parameters.
-#define INPUT_REPORT_NUM 2 // Keyboard report and Consumer Control report.
+#define INPUT_REPORT_NUM 5 // Keyboard, Consumer Control, NKRO keyboard, System Control and Mouse reports.
 
 // Keyboard input report.
 #define KB_INPUT_REPORT_INDEX   0 // Index of Keyboard Input Report.
@@ -65,7 +70,25 @@
 // Consumer Control input report.
 #define CC_INPUT_REPORT_INDEX   1
 #define CC_INPUT_REPORT_ID      2
-#define CC_INPUT_REPORT_MAX_LEN sizeof(uint16_t)
+#define CC_USAGE_SLOTS          3 // Consumer usages reported at once.
+#define CC_INPUT_REPORT_MAX_LEN (CC_USAGE_SLOTS * sizeof(uint16_t))
+
+// NKRO keyboard input report, modifiers then a bitmap of usages 0x00 to NKRO_USAGE_MAX.
+#define NKRO_INPUT_REPORT_INDEX   2
+#define NKRO_INPUT_REPORT_ID      3
+#define NKRO_USAGE_MAX            0xA4 // Keyboard ExSel.
+#define NKRO_BITMAP_LEN           ((NKRO_USAGE_MAX + 8) / 8)
+#define NKRO_INPUT_REPORT_MAX_LEN (1 + NKRO_BITMAP_LEN) // Needs an ATT MTU of 25, the 6 key report is used below it.
+
+// System Control input report, one Generic Desktop usage such as System Power Down.
+#define SYSTEM_INPUT_REPORT_INDEX   3
+#define SYSTEM_INPUT_REPORT_ID      4
+#define SYSTEM_INPUT_REPORT_MAX_LEN sizeof(uint8_t)
+
+// Mouse input report, buttons then X, Y and wheel.
+#define MOUSE_INPUT_REPORT_INDEX   4
+#define MOUSE_INPUT_REPORT_ID      5
+#define MOUSE_INPUT_REPORT_MAX_LEN 4
 
 // Output (LEDs) report.
 #define OUTPUT_REPORT_INDEX              0    // Index of Output Report.
@@ -91,17 +114,81 @@
 #define DEVICE_CONNECTION_KEY 0x4816
 
 // Firmware parameters.
-#define KEY_NUM               (MASTER_KEY_NUM + SLAVE_KEY_NUM)
-#define MASTER_KEY_NUM        10
-#define SLAVE_KEY_NUM         10
-#define HID_REPORT_BUFFER_NUM 5
-
-#define PIN_SET_DELAY        100 // In us (micro seconds), 100us should be enough.
-#define SCAN_DELAY           2
+#define KEY_NUM                (MASTER_KEY_NUM + SLAVE_KEY_NUM)
+#define MASTER_KEY_NUM         10
+#define SLAVE_KEY_NUM          10
+#define HID_REPORT_BUFFER_NUM  5 // Reports buffered for each report type but keyboard ones while the SoftDevice has no slot.
+#define KB_REPORT_QUEUE_SIZE   32 // Key transitions queued for each keyboard report type, less than 256. Reports past it are kept pending.
+#define PENDING_REPORT_NUM     64 // Reports kept while the link is down or a keyboard queue is full, less than 256. Holds about one key press each.
+#define PENDING_REPORT_MAX_AGE 5000 // In ms, reports made while the link is down and kept longer are not sent.
+
+#define PIN_SET_DELAY        100 // In us (micro seconds), 100us should be enough. Waited on a TIMER, not busy-waited.
+#define SCAN_DELAY           1 // In ms, scan period while keys change. Debounce windows are counted in these scans.
 #define SCAN_DELAY_TICKS     APP_TIMER_TICKS(SCAN_DELAY)
 #define KEY_PRESS_DEBOUNCE   8
 #define KEY_RELEASE_DEBOUNCE 32
+#define KEY_EAGER_DEBOUNCE   5 // In ms, eager algorithms ignore the key this long after a change, longer than contact bounce.
 #define OPERATION_DELAY      1 // In ms, 1ms should be enough.
-#define LOW_POWER_MODE_DELAY 3000 // In ms.
+#define UPTIME_READ_INTERVAL 256000 // In ms, uptime is read at least this often, within the 512 s app_timer wrap.
+
+// Scan rate tiers.
+// Scanning runs at the first tier while keys change or bounce and steps down a tier after each timeout passes
+// without a change. Once no key is held, rows wait on sense instead.
+#define SCAN_TIER_NUM      4
+#define SCAN_TIER_PERIODS  {SCAN_DELAY, 2, 5, 10} // In ms.
+#define SCAN_TIER_TIMEOUTS {50, 250, 1000} // In ms, quiet time before leaving each tier but the last.
+
+// Radio synced scan.
+#define SCAN_RADIO_SYNC          0 // Set 1 to also scan before every radio event while keys are held in a slow tier.
+#define SCAN_RADIO_SYNC_DISTANCE NRF_RADIO_NOTIFICATION_DISTANCE_1740US // Lead time of the scan, covers a strobe pass.
+
+// Matrix ghost modes, selected by MATRIX_GHOST_MODE in keyboard.h.
+#define MATRIX_GHOST_NONE  0 // Keys have diodes, rows are taken as read.
+#define MATRIX_GHOST_BLOCK 1 // New presses on a rectangle of read keys are ignored until it breaks up.
+
+// Debounce algorithms.
+#define DEBOUNCE_DEFER_PER_KEY              0 // A key changes once it has been stable for the window.
+#define DEBOUNCE_EAGER_PER_KEY              1 // A key changes at once, then ignores bounce for KEY_EAGER_DEBOUNCE.
+#define DEBOUNCE_EAGER_PRESS_DEFER_RELEASE  2 // Presses are eager, releases are deferred.
+#define DEBOUNCE_DEFER_PER_COLUMN           3 // Like DEFER_PER_KEY, with one counter for every key of a column.
+#define DEBOUNCE_EAGER_PER_COLUMN           4 // Like EAGER_PER_KEY, with one counter for every key of a column.
+#ifndef DEBOUNCE_ALGORITHM // Host benchmarks set it on the command line.
+#define DEBOUNCE_ALGORITHM                  DEBOUNCE_DEFER_PER_KEY
+#endif
+
+// Cycle stats parameters.
+#ifndef CYCLE_STATS_ENABLED // Host checks set it on the command line.
+#define CYCLE_STATS_ENABLED        0 // Count DWT cycles of scan, key index update, translation and report generation.
+#endif
+#define CYCLE_STATS_HISTOGRAM_BINS 20 // Log2 bins, last bin takes everything from 2^18 cycles.
+#define CYCLE_STATS_LOG_INTERVAL   1000 // Stats are logged every this many scans.
+
+// Key event parameters.
+#define KEY_INDEX_MAX         (MATRIX_COL_NUM * MATRIX_ROW_NUM * 2) // Key indexes of both halves run from 1 to this.
+#define KEY_EVENT_QUEUE_SIZE  32 // Must be a power of 2.
+#define KEY_EVENT_ACTIVE_MAX  (MASTER_KEY_NUM > SLAVE_KEY_NUM ? MASTER_KEY_NUM : SLAVE_KEY_NUM) // Largest active key list.
+
+// Tap hold parameters.
+#define TAPPING_TERM                     200 // In ms, a tap hold key held this long is a hold. Codes may override it.
+#define TAP_HOLD_QUEUE_SIZE              8 // Events kept while a tap hold key is undecided, a full queue makes it a hold.
+#define TAP_HOLD_PERMISSIVE_HOLD         1 // Another key pressed and released within the term makes it a hold.
+#define TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS 0 // Another key pressed within the term makes it a hold.
+
+// Combo parameters.
+#define COMBO_TERM    50 // In ms, every key of a combo must be pressed within this from the first.
+#define COMBO_KEY_MAX 4 // Keys of a combo.
+#ifndef COMBO_NUM_MAX // Host benchmarks set it on the command line.
+#define COMBO_NUM_MAX 32 // Combos in config/combos.h, less than 256. Matching costs a word per 32 combos.
+#endif
+
+// Mouse key parameters.
+#define MOUSE_KEYS_SPEED_MIN   50 // In counts per second, pointer speed as a move key is pressed.
+#define MOUSE_KEYS_SPEED_MAX   800 // In counts per second.
+#define MOUSE_KEYS_TIME_TO_MAX 1000 // In ms, held time to reach MOUSE_KEYS_SPEED_MAX.
+#define MOUSE_KEYS_CURVE       2 // Power of the acceleration curve, 0 for constant, 1 for linear and 2 for quadratic.
+#define MOUSE_KEYS_WHEEL_SPEED 10 // In notches per second.
+
+// Matrix strobe parameters.
+#define MATRIX_STROBE_TIMER_INSTANCE 1 // TIMER instance used for column settle time, TIMER0 is used by SoftDevice.
 
 #endif
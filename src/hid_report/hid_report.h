@@ -0,0 +1,32 @@
+#ifndef _HID_REPORT_H_
+#define _HID_REPORT_H_
+
+#include <stdint.h>
+
+#include "../firmware_config.h"
+
+typedef enum {
+    HID_TYPE_KB_REPORT, // Keyboard types come first, they are queued as key transitions.
+    HID_TYPE_NKRO_REPORT,
+    HID_TYPE_CC_REPORT,
+    HID_TYPE_SYSTEM_REPORT,
+    HID_TYPE_MOUSE_REPORT,
+    HID_TYPE_NUM
+} hid_report_type_t;
+
+#define HID_KB_TYPE_NUM 2 // Types before it are keyboard reports.
+
+typedef union {
+    uint8_t kb[KB_INPUT_REPORT_MAX_LEN];
+    uint16_t cc[CC_USAGE_SLOTS];
+    uint8_t nkro[NKRO_INPUT_REPORT_MAX_LEN]; // Modifiers are at the same place as in kb.
+    uint8_t system;
+    uint8_t mouse[MOUSE_INPUT_REPORT_MAX_LEN];
+} hid_report_data_t;
+
+typedef struct {
+    hid_report_type_t type;
+    hid_report_data_t data;
+} hid_report_t;
+
+#endif
@@ -0,0 +1,231 @@
+#include "kb_report_queue.h"
+
+#include <string.h>
+
+#define PRESS          0x100 // Transition flag.
+#define USAGE(t)       ((t) & 0xFF)
+#define MODIFIER_BYTE  (0xE0 / 8) // Byte of the state holding modifiers, same bit order as in reports.
+#define IS_MODIFIER(u) ((u) >= 0xE0 && (u) <= 0xE7)
+#define KEY_SLOT       2 // First key byte of a 6 key report.
+
+static bool bit_get(uint8_t const *p_state, uint8_t usage) {
+    return p_state[usage / 8] & (1U << (usage % 8));
+}
+
+static void bit_flip(uint8_t *p_state, uint8_t usage) {
+    p_state[usage / 8] ^= 1U << (usage % 8);
+}
+
+static uint16_t transition_get(kb_report_queue_t const *p_queue, uint8_t index) {
+    return p_queue->transitions[(p_queue->start + index) % KB_REPORT_QUEUE_SIZE];
+}
+
+static void transition_remove(kb_report_queue_t *p_queue, uint8_t index) {
+    for (int i = index; i < p_queue->count - 1; i++) {
+        p_queue->transitions[(p_queue->start + i) % KB_REPORT_QUEUE_SIZE] = transition_get(p_queue, i + 1);
+    }
+
+    p_queue->count--;
+}
+
+static void state_from_report(kb_report_queue_t const *p_queue, uint8_t const *p_report, uint8_t *p_state) {
+    memset(p_state, 0, KB_STATE_LEN);
+
+    if (p_queue->nkro) {
+        memcpy(p_state, &p_report[1], NKRO_BITMAP_LEN);
+    } else {
+        for (int i = KEY_SLOT; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+            if (p_report[i] != 0) {
+                bit_flip(p_state, p_report[i]);
+            }
+        }
+    }
+
+    p_state[MODIFIER_BYTE] = p_report[0];
+}
+
+static bool has_slot(uint8_t const *p_report, uint8_t usage) {
+    for (int i = KEY_SLOT; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+        if (p_report[i] == usage) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void report_from_state(kb_report_queue_t const *p_queue, uint8_t const *p_state, uint8_t *p_report) {
+    if (p_queue->nkro) {
+        p_report[0] = p_state[MODIFIER_BYTE];
+        memcpy(&p_report[1], p_state, NKRO_BITMAP_LEN);
+        return;
+    }
+
+    memset(p_report, 0, KB_INPUT_REPORT_MAX_LEN);
+    p_report[0] = p_state[MODIFIER_BYTE];
+
+    // Keys keep the slot they have on the host. More than 6 keys are only down after an overflow, the rest wait for a
+    // free slot and none is seen pressed twice.
+    for (int i = KEY_SLOT; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+        uint8_t usage = p_queue->slots[i - KEY_SLOT];
+
+        if (usage != 0 && bit_get(p_state, usage)) {
+            p_report[i] = usage;
+        }
+    }
+
+    for (int usage = 1, i = KEY_SLOT; usage < 0xE0 && i < KB_INPUT_REPORT_MAX_LEN; usage++) {
+        if (!bit_get(p_state, usage) || has_slot(p_report, usage)) {
+            continue;
+        }
+
+        while (i < KB_INPUT_REPORT_MAX_LEN && p_report[i] != 0) {
+            i++;
+        }
+
+        if (i < KB_INPUT_REPORT_MAX_LEN) {
+            p_report[i] = usage;
+        }
+    }
+}
+
+// Keys of the next report into p_state. Returns how many queued transitions it takes.
+static uint8_t batch_build(kb_report_queue_t const *p_queue, uint8_t *p_state) {
+    uint8_t touched[KB_STATE_LEN];
+    bool key_pressed = false;
+    uint8_t n;
+
+    memcpy(p_state, p_queue->next, KB_STATE_LEN);
+
+    for (int i = 0; i < KB_STATE_LEN; i++) {
+        touched[i] = p_queue->next[i] ^ p_queue->sent[i];
+
+        if (i < MODIFIER_BYTE && (touched[i] & p_state[i])) {
+            key_pressed = true;
+        }
+    }
+
+    for (n = 0; n < p_queue->count; n++) {
+        uint16_t transition = transition_get(p_queue, n);
+        uint8_t usage = USAGE(transition);
+        bool press = (transition & PRESS) && !IS_MODIFIER(usage);
+
+        // A modifier after a key press would change what the key types. Two key presses in one report reach the host
+        // in slot or usage order, not in the order they were made.
+        if (bit_get(touched, usage) || (key_pressed && (IS_MODIFIER(usage) || press))) {
+            break;
+        }
+
+        bit_flip(p_state, usage);
+        bit_flip(touched, usage);
+
+        key_pressed |= press;
+    }
+
+    return n;
+}
+
+// Oldest transition goes into the next report if it may share it. Returns false if it may not.
+static bool transition_fold(kb_report_queue_t *p_queue) {
+    uint8_t state[KB_STATE_LEN];
+
+    if (batch_build(p_queue, state) == 0) {
+        return false;
+    }
+
+    bit_flip(p_queue->next, USAGE(transition_get(p_queue, 0)));
+    transition_remove(p_queue, 0);
+
+    return true;
+}
+
+static void transition_push(kb_report_queue_t *p_queue, uint16_t transition) {
+    // Only a report put into an empty queue gets here. Its transitions happen together and each key changes once, so
+    // they may share one report.
+    if (p_queue->count == KB_REPORT_QUEUE_SIZE) {
+        bit_flip(p_queue->next, USAGE(transition_get(p_queue, 0)));
+        transition_remove(p_queue, 0);
+    }
+
+    p_queue->transitions[(p_queue->start + p_queue->count) % KB_REPORT_QUEUE_SIZE] = transition;
+    p_queue->count++;
+}
+
+void kb_report_queue_init(kb_report_queue_t *p_queue, bool nkro) {
+    memset(p_queue, 0, sizeof(kb_report_queue_t));
+
+    p_queue->nkro = nkro;
+}
+
+bool kb_report_queue_put(kb_report_queue_t *p_queue, uint8_t const *p_report) {
+    uint8_t state[KB_STATE_LEN];
+    uint16_t n = 0;
+
+    state_from_report(p_queue, p_report, state);
+
+    for (int i = 0; i < KB_STATE_LEN; i++) {
+        n += __builtin_popcount(p_queue->last[i] ^ state[i]);
+    }
+
+    // Oldest transitions sharing the next report make room, the report waits if that is not enough.
+    while (p_queue->count + n > KB_REPORT_QUEUE_SIZE && !kb_report_queue_is_empty(p_queue)) {
+        if (!transition_fold(p_queue)) {
+            return false;
+        }
+    }
+
+    // Releases go first, a key taking the slot of another is pressed after it is let go.
+    for (int pass = 0; pass < 2; pass++) {
+        bool press = pass == 1;
+
+        for (int i = 0; i < KB_STATE_LEN; i++) {
+            uint8_t bits = (p_queue->last[i] ^ state[i]) & (press ? state[i] : p_queue->last[i]);
+
+            while (bits != 0) {
+                int bit = __builtin_ctz(bits);
+
+                bits &= bits - 1;
+
+                transition_push(p_queue, (i * 8 + bit) | (press ? PRESS : 0));
+            }
+        }
+    }
+
+    memcpy(p_queue->last, state, KB_STATE_LEN);
+
+    return true;
+}
+
+bool kb_report_queue_peek(kb_report_queue_t *p_queue, uint8_t *p_report) {
+    uint8_t state[KB_STATE_LEN];
+
+    if (kb_report_queue_is_empty(p_queue)) {
+        return false;
+    }
+
+    batch_build(p_queue, state);
+    report_from_state(p_queue, state, p_report);
+
+    return true;
+}
+
+void kb_report_queue_pop(kb_report_queue_t *p_queue) {
+    uint8_t state[KB_STATE_LEN];
+    uint8_t report[KB_INPUT_REPORT_MAX_LEN];
+    uint8_t n = batch_build(p_queue, state);
+
+    if (!p_queue->nkro) {
+        report_from_state(p_queue, state, report);
+        memcpy(p_queue->slots, &report[KEY_SLOT], sizeof(p_queue->slots));
+    }
+
+    memcpy(p_queue->sent, state, KB_STATE_LEN);
+    memcpy(p_queue->next, state, KB_STATE_LEN);
+
+    p_queue->start = (p_queue->start + n) % KB_REPORT_QUEUE_SIZE;
+    p_queue->count -= n;
+}
+
+bool kb_report_queue_is_empty(kb_report_queue_t const *p_queue) {
+    return p_queue->count == 0 && memcmp(p_queue->next, p_queue->sent, KB_STATE_LEN) == 0;
+}
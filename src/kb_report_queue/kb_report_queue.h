@@ -0,0 +1,47 @@
+#ifndef _KB_REPORT_QUEUE_H_
+#define _KB_REPORT_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../firmware_config.h"
+
+/*
+ * Keyboard report queue.
+ * Reports put in are kept as the key transitions between them. The report taken out holds as many transitions as
+ * can share one report: a key changing twice, a second key press, or a modifier changing after a key press starts
+ * the next one. So a tap is never merged away, keys reach the host in the order they were pressed whatever their
+ * usages, and the last report out is always the last report put in.
+ *
+ * When the queue is full, the oldest transitions go into the next report while that is safe as above. A report whose
+ * transitions still do not fit is refused and the queue keeps the reports it had, no transition is ever dropped. An empty
+ * queue takes any report, the transitions of one report happen together.
+ */
+
+#define KB_STATE_LEN 32 // Bitmap of every usage, modifiers are 0xE0 to 0xE7 as in the Keyboard usage page.
+
+typedef struct {
+    bool nkro;                      // Reports are NKRO reports, else 6 key reports.
+    uint8_t sent[KB_STATE_LEN];     // Keys as the host has them.
+    uint8_t next[KB_STATE_LEN];     // Keys of the next report before queued transitions, holds those folded in when full.
+    uint8_t last[KB_STATE_LEN];     // Keys of the last report put in.
+    uint8_t slots[KB_INPUT_REPORT_MAX_LEN - 2]; // Keys of a 6 key report as the host has them.
+    uint16_t transitions[KB_REPORT_QUEUE_SIZE]; // Usage, with bit 8 set for a press.
+    uint8_t start;
+    uint8_t count;
+} kb_report_queue_t;
+
+void kb_report_queue_init(kb_report_queue_t *p_queue, bool nkro);
+
+// Returns false if the transitions of the report do not fit, the caller keeps it until the queue is empty.
+bool kb_report_queue_put(kb_report_queue_t *p_queue, uint8_t const *p_report);
+
+// Writes the next report to send. Returns false if the host has every report already.
+bool kb_report_queue_peek(kb_report_queue_t *p_queue, uint8_t *p_report);
+
+// The report of the last peek was sent.
+void kb_report_queue_pop(kb_report_queue_t *p_queue);
+
+bool kb_report_queue_is_empty(kb_report_queue_t const *p_queue);
+
+#endif
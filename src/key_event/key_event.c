@@ -0,0 +1,129 @@
+#include "key_event.h"
+
+#include <string.h>
+
+#include "../port/port.h"
+
+#define QUEUE_MASK (KEY_EVENT_QUEUE_SIZE - 1)
+
+STATIC_ASSERT((KEY_EVENT_QUEUE_SIZE & QUEUE_MASK) == 0);
+STATIC_ASSERT(KEY_EVENT_QUEUE_SIZE < 256);
+
+static key_event_t m_queue[KEY_EVENT_QUEUE_SIZE];
+
+// Free running, head is only written by producer and tail only by consumer.
+static volatile uint8_t m_head;
+static volatile uint8_t m_tail;
+static volatile uint32_t m_dropped;
+
+void key_event_init(void) {
+    m_head = 0;
+    m_tail = 0;
+    m_dropped = 0;
+}
+
+bool key_event_put(key_event_t const *p_event) {
+    uint8_t head = m_head;
+
+    if ((uint8_t)(head - m_tail) == KEY_EVENT_QUEUE_SIZE) {
+        m_dropped++;
+        return false;
+    }
+
+    m_queue[head & QUEUE_MASK] = *p_event;
+
+    // Event must be written before it is published.
+    PORT_MEMORY_BARRIER();
+    m_head = head + 1;
+
+    return true;
+}
+
+bool key_event_get(key_event_t *p_event) {
+    uint8_t tail = m_tail;
+
+    if (tail == m_head) {
+        return false;
+    }
+
+    PORT_MEMORY_BARRIER();
+    *p_event = m_queue[tail & QUEUE_MASK];
+
+    // Event must be read before its slot is released.
+    PORT_MEMORY_BARRIER();
+    m_tail = tail + 1;
+
+    return true;
+}
+
+uint32_t key_event_dropped_get(void) {
+    return m_dropped;
+}
+
+void key_event_active_init(key_event_active_t *p_active, uint8_t size) {
+    memset(p_active, 0, sizeof(key_event_active_t));
+
+    p_active->size = size < KEY_EVENT_ACTIVE_MAX ? size : KEY_EVENT_ACTIVE_MAX;
+}
+
+void key_event_active_apply(key_event_active_t *p_active, key_event_t const *p_event) {
+    uint8_t *p_position = &p_active->position[p_event->key_index];
+
+    if (p_event->pressed) {
+        // Keys pressed over the list size are not reported.
+        if (*p_position == 0 && p_active->count < p_active->size) {
+            p_active->key_index[p_active->count++] = p_event->key_index;
+            *p_position = p_active->count;
+        }
+    } else if (*p_position != 0) {
+        // Move last key into the freed slot.
+        int8_t last = p_active->key_index[--p_active->count];
+
+        p_active->key_index[*p_position - 1] = last;
+        p_active->position[last] = *p_position;
+        *p_position = 0;
+    }
+}
+
+void key_set_add(key_set_t *p_set, int8_t key_index) {
+    p_set->words[key_index / 32] |= 1UL << (key_index % 32);
+}
+
+void key_set_remove(key_set_t *p_set, int8_t key_index) {
+    p_set->words[key_index / 32] &= ~(1UL << (key_index % 32));
+}
+
+bool key_set_has(key_set_t const *p_set, int8_t key_index) {
+    return (p_set->words[key_index / 32] & (1UL << (key_index % 32))) != 0;
+}
+
+void key_set_from_list(key_set_t *p_set, int8_t const *p_key_index, uint16_t size) {
+    memset(p_set, 0, sizeof(key_set_t));
+
+    for (int i = 0; i < size; i++) {
+        if (p_key_index[i] >= 1 && p_key_index[i] <= KEY_INDEX_MAX) {
+            key_set_add(p_set, p_key_index[i]);
+        }
+    }
+}
+
+void key_set_diff(key_set_t const *p_old, key_set_t const *p_new, key_set_t *p_released, key_set_t *p_pressed) {
+    for (int word = 0; word < KEY_SET_WORDS; word++) {
+        p_released->words[word] = p_old->words[word] & ~p_new->words[word];
+        p_pressed->words[word] = p_new->words[word] & ~p_old->words[word];
+    }
+}
+
+int8_t key_set_pop(key_set_t *p_set) {
+    for (int word = 0; word < KEY_SET_WORDS; word++) {
+        uint32_t bits = p_set->words[word];
+
+        if (bits != 0) {
+            p_set->words[word] = bits & (bits - 1);
+
+            return word * 32 + __builtin_ctz(bits);
+        }
+    }
+
+    return -1;
+}
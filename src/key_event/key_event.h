@@ -0,0 +1,64 @@
+#ifndef _KEY_EVENT_H_
+#define _KEY_EVENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../config/keyboard.h"
+#include "../firmware_config.h"
+
+/*
+ * Key transitions in the order they were seen.
+ * The matrix engine puts events, one consumer gets them. Queue is lock free for a single producer and a single
+ * consumer, so the producer may run in interrupt context.
+ */
+
+typedef struct {
+    uint32_t timestamp; // RTC ticks of the pass that saw the transition.
+    int8_t key_index;
+    bool pressed;
+    uint8_t combo;      // Combo index + 1 when the press stands for a combo, 0 for a single key.
+} key_event_t;
+
+// Set of key indexes, bit n is key index n.
+#define KEY_SET_WORDS ((KEY_INDEX_MAX + 32) / 32)
+
+typedef struct {
+    uint32_t words[KEY_SET_WORDS];
+} key_set_t;
+
+void key_set_add(key_set_t *p_set, int8_t key_index);
+void key_set_remove(key_set_t *p_set, int8_t key_index);
+bool key_set_has(key_set_t const *p_set, int8_t key_index);
+
+// Set of the keys of a list, indexes outside 1 to KEY_INDEX_MAX are left out.
+void key_set_from_list(key_set_t *p_set, int8_t const *p_key_index, uint16_t size);
+
+// Keys only in p_old go to p_released, keys only in p_new to p_pressed. Cost is KEY_SET_WORDS, whatever is held.
+void key_set_diff(key_set_t const *p_old, key_set_t const *p_new, key_set_t *p_released, key_set_t *p_pressed);
+
+// Removes and returns the lowest key index of the set, -1 if it is empty.
+int8_t key_set_pop(key_set_t *p_set);
+
+// Keys currently pressed, kept up to date from events. Adding and removing a key are O(1), order is not kept.
+typedef struct {
+    int8_t key_index[KEY_EVENT_ACTIVE_MAX];
+    uint8_t position[KEY_INDEX_MAX + 1]; // Position + 1 of each key index in key_index, 0 if not pressed.
+    uint8_t count;
+    uint8_t size;
+} key_event_active_t;
+
+void key_event_init(void);
+
+// Returns false if queue is full, the event is then dropped and counted.
+bool key_event_put(key_event_t const *p_event);
+
+// Returns false if queue is empty.
+bool key_event_get(key_event_t *p_event);
+
+uint32_t key_event_dropped_get(void);
+
+void key_event_active_init(key_event_active_t *p_active, uint8_t size);
+void key_event_active_apply(key_event_active_t *p_active, key_event_t const *p_event);
+
+#endif
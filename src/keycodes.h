@@ -22,13 +22,45 @@
 #define DEVICE(code)                  ((code) - KC_DEVICE_1)
 
 // Layer switching.
-#define IS_LAYER(code) (KC_LAYER_BASE <= (code) && (code) <= KC_LAYER_F)
-#define LAYER(code)    ((code) - KC_LAYER_BASE)
+#define IS_LAYER(code)           (KC_LAYER_BASE <= (code) && (code) <= KC_LAYER_F)
+#define LAYER(code)              ((code) - KC_LAYER_BASE)
+#define IS_LAYER_TOGGLE(code)    (KC_LAYER_TOGGLE_BASE <= (code) && (code) <= KC_LAYER_TOGGLE_F)
+#define IS_LAYER_ONE_SHOT(code)  (KC_LAYER_ONE_SHOT_BASE <= (code) && (code) <= KC_LAYER_ONE_SHOT_F)
+#define IS_LAYER_DEFAULT(code)   (KC_LAYER_DEFAULT_BASE <= (code) && (code) <= KC_LAYER_DEFAULT_F)
+#define IS_LAYER_ACTION(code)    (IS_LAYER(code) || (KC_LAYER_TOGGLE_BASE <= (code) && (code) <= KC_LAYER_DEFAULT_F))
+#define LAYER_ACTION_LAYER(code) (IS_LAYER(code) ? LAYER(code) : ((code) & 0x0F)) // Toggle, one shot and default codes are 16-aligned.
 
 // Consumer control.
 #define IS_CONSUMER(code)   (KC_AUDIO_MUTE <= (code) && (code) <= KC_BRIGHTNESS_DOWN)
 #define CONSUMER_CODE(code) (CC_KEYCODES[(code - KC_AUDIO_MUTE)])
 
+// System control. Pattern: 0x04{0000}{UU}, U is the Generic Desktop usage.
+#define IS_SYSTEM(code)   (((code) & 0x0F000000) == KC_SYSTEM)
+#define SYSTEM_CODE(code) ((code) & 0xFF)
+
+// Mouse keys. Pattern: 0x05{0000}{MM}, M is the index of the mouse key.
+#define IS_MOUSE(code)   (((code) & 0x0F000000) == KC_MOUSE)
+#define MOUSE_CODE(code) ((code) & 0xFF)
+
+// Tap hold. Pattern: 0x{T}{Y}{AA}{CCCC}.
+// T is the tapping term in TAPPING_TERM_STEP ms, 0 for TAPPING_TERM. Y is the type, A the modifier bits of a mod tap
+// or the layer of a layer tap, C the code sent on tap.
+#define TAPPING_TERM_STEP           25
+#define IS_MOD_TAP(code)            (((code) & 0x0F000000) == KC_MOD_TAP)
+#define IS_LAYER_TAP(code)          (((code) & 0x0F000000) == KC_LAYER_TAP)
+#define IS_TAP_HOLD(code)           (IS_MOD_TAP(code) || IS_LAYER_TAP(code))
+#define MT(mod_code, code)          (KC_MOD_TAP | ((uint32_t)(mod_code) << 8) | (code))
+#define LT(layer, code)             (KC_LAYER_TAP | ((uint32_t)(layer) << 16) | (code))
+#define TAPPING_TERM_SET(code, ms)  ((code) | ((uint32_t)((ms) / TAPPING_TERM_STEP) << 28))
+#define TAP_HOLD_TERM_STEPS(code)   ((code) >> 28)
+#define TAP_CODE(code)              ((code) & 0xFFFF)
+#define HOLD_CODE(code)             (IS_MOD_TAP(code) ? ((code) >> 8) & 0xFF00 : KC_LAYER_BASE + (((code) >> 16) & 0x0F))
+
+// Macros, played from MACROS of config/macros.h.
+#define IS_MACRO(code)    (((code) & 0x0F000000) == KC_MACRO)
+#define MACRO(index)      (KC_MACRO | (index))
+#define MACRO_INDEX(code) ((code) & 0xFF)
+
 /*
  * Short names for ease of definition of keymap
  */
@@ -112,6 +144,24 @@
 #define KC_BRIU KC_BRIGHTNESS_UP
 #define KC_BRID KC_BRIGHTNESS_DOWN
 
+// System control.
+#define KC_PWR  KC_SYSTEM_POWER
+#define KC_SLEP KC_SYSTEM_SLEEP
+#define KC_WAKE KC_SYSTEM_WAKE
+
+// Mouse keys.
+#define KC_MS_U KC_MS_UP
+#define KC_MS_D KC_MS_DOWN
+#define KC_MS_L KC_MS_LEFT
+#define KC_MS_R KC_MS_RIGHT
+#define KC_BTN1 KC_MS_BTN1
+#define KC_BTN2 KC_MS_BTN2
+#define KC_BTN3 KC_MS_BTN3
+#define KC_BTN4 KC_MS_BTN4
+#define KC_BTN5 KC_MS_BTN5
+#define KC_WH_U KC_MS_WH_UP
+#define KC_WH_D KC_MS_WH_DOWN
+
 // Devices connection.
 #define KC_DVC1 KC_DEVICE_1
 #define KC_DVC2 KC_DEVICE_2
@@ -135,6 +185,68 @@
 #define KC_LE   KC_LAYER_E
 #define KC_LF   KC_LAYER_F
 
+// Layer toggle.
+#define KC_TG1  KC_LAYER_TOGGLE_1
+#define KC_TG2  KC_LAYER_TOGGLE_2
+#define KC_TG3  KC_LAYER_TOGGLE_3
+#define KC_TG4  KC_LAYER_TOGGLE_4
+#define KC_TG5  KC_LAYER_TOGGLE_5
+#define KC_TG6  KC_LAYER_TOGGLE_6
+#define KC_TG7  KC_LAYER_TOGGLE_7
+#define KC_TG8  KC_LAYER_TOGGLE_8
+#define KC_TG9  KC_LAYER_TOGGLE_9
+#define KC_TGA  KC_LAYER_TOGGLE_A
+#define KC_TGB  KC_LAYER_TOGGLE_B
+#define KC_TGC  KC_LAYER_TOGGLE_C
+#define KC_TGD  KC_LAYER_TOGGLE_D
+#define KC_TGE  KC_LAYER_TOGGLE_E
+#define KC_TGF  KC_LAYER_TOGGLE_F
+
+// One shot layer, active for the next key only.
+#define KC_OS1  KC_LAYER_ONE_SHOT_1
+#define KC_OS2  KC_LAYER_ONE_SHOT_2
+#define KC_OS3  KC_LAYER_ONE_SHOT_3
+#define KC_OS4  KC_LAYER_ONE_SHOT_4
+#define KC_OS5  KC_LAYER_ONE_SHOT_5
+#define KC_OS6  KC_LAYER_ONE_SHOT_6
+#define KC_OS7  KC_LAYER_ONE_SHOT_7
+#define KC_OS8  KC_LAYER_ONE_SHOT_8
+#define KC_OS9  KC_LAYER_ONE_SHOT_9
+#define KC_OSA  KC_LAYER_ONE_SHOT_A
+#define KC_OSB  KC_LAYER_ONE_SHOT_B
+#define KC_OSC  KC_LAYER_ONE_SHOT_C
+#define KC_OSD  KC_LAYER_ONE_SHOT_D
+#define KC_OSE  KC_LAYER_ONE_SHOT_E
+#define KC_OSF  KC_LAYER_ONE_SHOT_F
+
+// Default layer.
+#define KC_DFBS KC_LAYER_DEFAULT_BASE
+#define KC_DF1  KC_LAYER_DEFAULT_1
+#define KC_DF2  KC_LAYER_DEFAULT_2
+#define KC_DF3  KC_LAYER_DEFAULT_3
+#define KC_DF4  KC_LAYER_DEFAULT_4
+#define KC_DF5  KC_LAYER_DEFAULT_5
+#define KC_DF6  KC_LAYER_DEFAULT_6
+#define KC_DF7  KC_LAYER_DEFAULT_7
+#define KC_DF8  KC_LAYER_DEFAULT_8
+#define KC_DF9  KC_LAYER_DEFAULT_9
+#define KC_DFA  KC_LAYER_DEFAULT_A
+#define KC_DFB  KC_LAYER_DEFAULT_B
+#define KC_DFC  KC_LAYER_DEFAULT_C
+#define KC_DFD  KC_LAYER_DEFAULT_D
+#define KC_DFE  KC_LAYER_DEFAULT_E
+#define KC_DFF  KC_LAYER_DEFAULT_F
+
+// Mod tap, modifier on hold and code on tap.
+#define LCTL_T(code) MT(KC_LCTRL, code)
+#define LSFT_T(code) MT(KC_LSHIFT, code)
+#define LALT_T(code) MT(KC_LALT, code)
+#define LGUI_T(code) MT(KC_LGUI, code)
+#define RCTL_T(code) MT(KC_RCTRL, code)
+#define RSFT_T(code) MT(KC_RSHIFT, code)
+#define RALT_T(code) MT(KC_RALT, code)
+#define RGUI_T(code) MT(KC_RGUI, code)
+
 /*
  * Shifted keys
  */
@@ -475,7 +587,59 @@ enum special_keycodes {
     KC_WWW_REFRESH,
     KC_WWW_FAVORITES,
     KC_BRIGHTNESS_UP,
-    KC_BRIGHTNESS_DOWN
+    KC_BRIGHTNESS_DOWN,
+
+    // Layer toggle, one shot and default layer. Each group must start on a multiple of 16.
+    KC_LAYER_TOGGLE_BASE      = 0xD0,
+    KC_LAYER_TOGGLE_1,
+    KC_LAYER_TOGGLE_2,
+    KC_LAYER_TOGGLE_3,
+    KC_LAYER_TOGGLE_4,
+    KC_LAYER_TOGGLE_5,
+    KC_LAYER_TOGGLE_6,
+    KC_LAYER_TOGGLE_7,
+    KC_LAYER_TOGGLE_8,
+    KC_LAYER_TOGGLE_9,
+    KC_LAYER_TOGGLE_A,
+    KC_LAYER_TOGGLE_B,
+    KC_LAYER_TOGGLE_C,
+    KC_LAYER_TOGGLE_D,
+    KC_LAYER_TOGGLE_E,
+    KC_LAYER_TOGGLE_F,
+
+    KC_LAYER_ONE_SHOT_BASE    = 0xE0,
+    KC_LAYER_ONE_SHOT_1,
+    KC_LAYER_ONE_SHOT_2,
+    KC_LAYER_ONE_SHOT_3,
+    KC_LAYER_ONE_SHOT_4,
+    KC_LAYER_ONE_SHOT_5,
+    KC_LAYER_ONE_SHOT_6,
+    KC_LAYER_ONE_SHOT_7,
+    KC_LAYER_ONE_SHOT_8,
+    KC_LAYER_ONE_SHOT_9,
+    KC_LAYER_ONE_SHOT_A,
+    KC_LAYER_ONE_SHOT_B,
+    KC_LAYER_ONE_SHOT_C,
+    KC_LAYER_ONE_SHOT_D,
+    KC_LAYER_ONE_SHOT_E,
+    KC_LAYER_ONE_SHOT_F,
+
+    KC_LAYER_DEFAULT_BASE     = 0xF0,
+    KC_LAYER_DEFAULT_1,
+    KC_LAYER_DEFAULT_2,
+    KC_LAYER_DEFAULT_3,
+    KC_LAYER_DEFAULT_4,
+    KC_LAYER_DEFAULT_5,
+    KC_LAYER_DEFAULT_6,
+    KC_LAYER_DEFAULT_7,
+    KC_LAYER_DEFAULT_8,
+    KC_LAYER_DEFAULT_9,
+    KC_LAYER_DEFAULT_A,
+    KC_LAYER_DEFAULT_B,
+    KC_LAYER_DEFAULT_C,
+    KC_LAYER_DEFAULT_D,
+    KC_LAYER_DEFAULT_E,
+    KC_LAYER_DEFAULT_F
 };
 
 // Modifier keycodes.
@@ -499,8 +663,48 @@ enum modifier_keycodes {
     KC_RGUI             = 0x8000
 };
 
+// Tap hold, macro, system and mouse keycodes, above 16 bits. Type is in bits 24 to 27.
+enum extended_keycodes {
+    KC_MOD_TAP          = 0x01000000,
+    KC_LAYER_TAP        = 0x02000000,
+    KC_MACRO            = 0x03000000,
+    KC_SYSTEM           = 0x04000000,
+    KC_MOUSE            = 0x05000000
+};
+
+// System control keycodes, sent in the System Control report.
+enum system_keycodes {
+    KC_SYSTEM_POWER     = KC_SYSTEM | 0x81, // System Power Down.
+    KC_SYSTEM_SLEEP,    // System Sleep.
+    KC_SYSTEM_WAKE      // System Wake Up.
+};
+
+// Mouse keycodes, sent in the Mouse report.
+enum mouse_keycodes {
+    KC_MS_UP            = KC_MOUSE,
+    KC_MS_DOWN,
+    KC_MS_LEFT,
+    KC_MS_RIGHT,
+    KC_MS_BTN1,
+    KC_MS_BTN2,
+    KC_MS_BTN3,
+    KC_MS_BTN4,
+    KC_MS_BTN5,
+    KC_MS_WH_UP,
+    KC_MS_WH_DOWN
+};
+
+// Macro byte codes. Other bytes are typed as text: printable ASCII, '\t' and '\n', on a US layout.
+enum macro_byte_codes {
+    MACRO_END           = 0x00,
+    MACRO_TAP,          // Followed by a keycode, pressed and released.
+    MACRO_DOWN,         // Followed by a keycode, pressed until MACRO_UP.
+    MACRO_UP,           // Followed by a keycode.
+    MACRO_MODS          // Followed by modifier bits held from then on, e.g. MOD_BIT(KC_LCTRL), 0 for none.
+};
+
 // Consumer Control keycodes. Array items must be in order with Consumer Control keys definitions.
-const uint16_t CC_KEYCODES[] = {
+static const uint16_t CC_KEYCODES[] = {
     // Audio control.
     0x00E2, // AUDIO_MUTE.
     0x00E9, // AUDIO_VOL_UP.
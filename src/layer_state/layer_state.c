@@ -0,0 +1,65 @@
+#include "layer_state.h"
+
+#include <string.h>
+
+#include "../keycodes.h"
+
+#define LAYER_MAX 16 // Layers a mask holds.
+
+static uint8_t m_holders[LAYER_MAX]; // Momentary keys held down on each layer.
+static uint16_t m_momentary;         // Layers with holders.
+static uint16_t m_toggle;
+static uint16_t m_one_shot;
+static uint8_t m_default;
+
+void layer_state_init(void) {
+    memset(m_holders, 0, sizeof(m_holders));
+    m_momentary = 0;
+    m_toggle = 0;
+    m_one_shot = 0;
+    m_default = _BASE_LAYER;
+}
+
+bool layer_state_key(uint32_t code, bool pressed) {
+    if (!IS_LAYER_ACTION(code)) {
+        return false;
+    }
+
+    uint8_t layer = LAYER_ACTION_LAYER(code);
+    uint16_t bit = 1U << layer;
+
+    if (IS_LAYER(code)) {
+        // Two keys holding the same layer keep it until both are let go.
+        if (pressed) {
+            m_holders[layer]++;
+        } else if (m_holders[layer] > 0) {
+            m_holders[layer]--;
+        }
+
+        if (m_holders[layer] > 0) {
+            m_momentary |= bit;
+        } else {
+            m_momentary &= ~bit;
+        }
+    } else if (pressed) {
+        if (IS_LAYER_TOGGLE(code)) {
+            m_toggle ^= bit;
+        } else if (IS_LAYER_ONE_SHOT(code)) {
+            m_one_shot |= bit;
+        } else {
+            m_default = LAYER_ACTION_LAYER(code);
+        }
+    }
+
+    return true;
+}
+
+void layer_state_key_resolved(void) {
+    m_one_shot = 0;
+}
+
+uint8_t layer_state_highest(void) {
+    uint32_t state = m_momentary | m_toggle | m_one_shot | (1UL << m_default);
+
+    return 31 - __builtin_clz(state);
+}
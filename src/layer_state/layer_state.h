@@ -0,0 +1,24 @@
+#ifndef _LAYER_STATE_H_
+#define _LAYER_STATE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Layer state.
+ * Active layers are kept as a 16-bit mask that outlives key translation. The highest active layer is the one
+ * keys resolve on, the default layer is always active. A momentary layer stays on while any key holding it is down.
+ */
+
+void layer_state_init(void);
+
+// Apply a layer action code on press or release of its key. Returns false if code is not a layer action.
+bool layer_state_key(uint32_t code, bool pressed);
+
+// Call once a key other than a layer key resolved, one shot layers end there.
+void layer_state_key_resolved(void);
+
+// Highest active layer.
+uint8_t layer_state_highest(void);
+
+#endif
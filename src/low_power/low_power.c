@@ -1,18 +1,40 @@
 #include "low_power.h"
 
+#include <string.h>
+
 #include "app_error.h"
 #include "nrf_gpio.h"
 #include "nrf_log.h"
+#include "nrf_soc.h"
 #include "nrfx_gpiote.h"
 
 #include "../config/keyboard.h"
 #include "../firmware_config.h"
+#include "../matrix/matrix_strobe_nrf.h"
+#include "../uptime/uptime.h"
 
 static const app_timer_id_t *m_p_scan_timer_id;
 
 static void (*m_scan_timeout_handler)(void *);
 
+// True while rows are waiting on sense, set back by GPIOTE interrupt.
+static volatile bool m_active = false;
+
+static const uint16_t SCAN_TIER_PERIOD_MS[SCAN_TIER_NUM] = SCAN_TIER_PERIODS;
+static const uint16_t SCAN_TIER_TIMEOUT_MS[SCAN_TIER_NUM - 1] = SCAN_TIER_TIMEOUTS;
+
+// Current scan tier, SCAN_TIER_NUM while waiting on sense.
+static uint8_t m_tier = 0;
+// Times in ms of uptime, which keeps counting while rows wait on sense.
+static uint32_t m_tier_ms[SCAN_TIER_NUM + 1];
+static uint32_t m_tier_start;
+static uint32_t m_last_activity;
+
 static void gpiote_evt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+static void tier_enter(uint8_t tier, uint32_t now);
+#if SCAN_RADIO_SYNC
+static void radio_sync_init(void);
+#endif
 
 void low_power_mode_init(const app_timer_id_t *p_scan_timer_id, void (*scan_timeout_handler)(void *)) {
     ret_code_t err_code;
@@ -22,6 +44,11 @@ void low_power_mode_init(const app_timer_id_t *p_scan_timer_id, void (*scan_time
     m_p_scan_timer_id = p_scan_timer_id;
     m_scan_timeout_handler = scan_timeout_handler;
 
+    m_tier = 0;
+    m_tier_start = uptime_ms_get();
+    m_last_activity = m_tier_start;
+    memset(m_tier_ms, 0, sizeof(m_tier_ms));
+
     // Init GPIOTE module.
     if (!nrfx_gpiote_is_init()) {
         err_code = nrfx_gpiote_init();
@@ -35,29 +62,78 @@ void low_power_mode_init(const app_timer_id_t *p_scan_timer_id, void (*scan_time
         err_code = nrfx_gpiote_in_init(ROWS[i], &config, gpiote_evt_handler);
         APP_ERROR_CHECK(err_code);
     }
+
+#if SCAN_RADIO_SYNC
+    radio_sync_init();
+#endif
+}
+
+#if SCAN_RADIO_SYNC
+// A scan SCAN_RADIO_SYNC_DISTANCE before every radio event, so keys changed since the last scan make this event.
+static void radio_sync_init(void) {
+    ret_code_t err_code;
+
+    err_code = sd_nvic_ClearPendingIRQ(RADIO_NOTIFICATION_IRQn);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_nvic_SetPriority(RADIO_NOTIFICATION_IRQn, APP_IRQ_PRIORITY_LOW);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_nvic_EnableIRQ(RADIO_NOTIFICATION_IRQn);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_radio_notification_cfg_set(NRF_RADIO_NOTIFICATION_TYPE_INT_ON_ACTIVE, SCAN_RADIO_SYNC_DISTANCE);
+    APP_ERROR_CHECK(err_code);
+}
+
+void RADIO_NOTIFICATION_IRQHandler(void) {
+    // The fastest tier counts debounce windows in scans, it is left to the timer. Sense wakes scanning by itself.
+    if (m_active || m_tier == 0) {
+        return;
+    }
+
+    m_scan_timeout_handler(NULL);
 }
+#endif
 
 static void gpiote_evt_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action) {
     ret_code_t err_code;
 
     NRF_LOG_INFO("GPIOTE evt.");
 
+    // Several rows may fire at once, only the first one wakes scanning up.
+    if (!m_active) {
+        return;
+    }
+
+    m_active = false;
+
     for (int i = 0; i < MATRIX_ROW_NUM; i++) {
         nrfx_gpiote_in_event_disable(ROWS[i]);
     }
 
-    for (int i = 0; i < MATRIX_COL_NUM; i++) {
-        nrf_gpio_pin_clear(COLS[i]);
-    }
+    NRF_P0->OUTCLR = MATRIX_COL_PORT_MASK;
+
+    // A press woke the matrix, start at the fastest tier.
+    uint32_t now = uptime_ms_get();
+
+    tier_enter(0, now);
+    m_last_activity = now;
 
     // Scan matrix.
     m_scan_timeout_handler(NULL);
 
     // Start scan timer.
-    err_code = app_timer_start(*m_p_scan_timer_id, SCAN_DELAY_TICKS, NULL);
+    err_code = app_timer_start(*m_p_scan_timer_id, APP_TIMER_TICKS(SCAN_TIER_PERIOD_MS[0]), NULL);
     APP_ERROR_CHECK(err_code);
 }
 
+static void tier_enter(uint8_t tier, uint32_t now) {
+    m_tier_ms[m_tier] += now - m_tier_start;
+    m_tier_start = now;
+    m_tier = tier;
+}
+
 void low_power_mode_start() {
     ret_code_t err_code;
 
@@ -70,7 +146,54 @@ void low_power_mode_start() {
         nrfx_gpiote_in_event_enable(ROWS[i], true);
     }
 
-    for (int i = 0; i < MATRIX_COL_NUM; i++) {
-        nrf_gpio_pin_set(COLS[i]);
+    NRF_P0->OUTSET = MATRIX_COL_PORT_MASK;
+
+    tier_enter(SCAN_TIER_NUM, uptime_ms_get());
+
+    m_active = true;
+}
+
+bool low_power_mode_is_active(void) {
+    return m_active;
+}
+
+void low_power_scan_update(bool active, bool idle) {
+    ret_code_t err_code;
+    uint32_t now = uptime_ms_get();
+    uint8_t tier = 0;
+
+    if (idle) {
+        low_power_mode_start();
+        return;
+    }
+
+    if (active) {
+        m_last_activity = now;
+    } else {
+        // Keys are held without change, step down while quiet time passes each timeout.
+        uint32_t quiet = now - m_last_activity;
+
+        while (tier < SCAN_TIER_NUM - 1 && quiet >= SCAN_TIER_TIMEOUT_MS[tier]) {
+            tier++;
+        }
+    }
+
+    if (tier == m_tier) {
+        return;
     }
+
+    tier_enter(tier, now);
+
+    err_code = app_timer_stop(*m_p_scan_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(*m_p_scan_timer_id, APP_TIMER_TICKS(SCAN_TIER_PERIOD_MS[tier]), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+void low_power_tier_ms_get(uint32_t *p_ms) {
+    memcpy(p_ms, m_tier_ms, sizeof(m_tier_ms));
+
+    // Include time of the current tier so far.
+    p_ms[m_tier] += uptime_ms_get() - m_tier_start;
 }
@@ -1,9 +1,19 @@
 #ifndef _LOW_POWER_H_
 #define _LOW_POWER_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "app_timer.h"
 
 void low_power_mode_init(const app_timer_id_t *p_scan_timer_id, void (*scan_timeout_handler)(void *));
 void low_power_mode_start();
+bool low_power_mode_is_active(void);
+
+// Call after every matrix pass. Picks the scan tier from recent activity, or waits on sense when idle.
+void low_power_scan_update(bool active, bool idle);
+
+// Time spent in each scan tier in ms, wrapping. Entry SCAN_TIER_NUM is time spent waiting on sense.
+void low_power_tier_ms_get(uint32_t *p_ms);
 
 #endif
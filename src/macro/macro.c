@@ -0,0 +1,199 @@
+#include "macro.h"
+
+#include <string.h>
+
+#include "../keycodes.h"
+#include "../port/port.h"
+
+#define SHIFTED  0x80 // Flag of TEXT_CODES, every keycode used is below it.
+#define KEY_SLOT 2    // First key byte of a report.
+
+// Keycodes of printable ASCII from ' ', letters and digits are worked out instead.
+static const uint8_t TEXT_CODES['~' - ' ' + 1] = {
+    [' ' - ' ']  = KC_SPACE,
+    ['!' - ' ']  = KC_1 | SHIFTED,
+    ['"' - ' ']  = KC_QUOTE | SHIFTED,
+    ['#' - ' ']  = KC_3 | SHIFTED,
+    ['$' - ' ']  = KC_4 | SHIFTED,
+    ['%' - ' ']  = KC_5 | SHIFTED,
+    ['&' - ' ']  = KC_7 | SHIFTED,
+    ['\'' - ' '] = KC_QUOTE,
+    ['(' - ' ']  = KC_9 | SHIFTED,
+    [')' - ' ']  = KC_0 | SHIFTED,
+    ['*' - ' ']  = KC_8 | SHIFTED,
+    ['+' - ' ']  = KC_EQUAL | SHIFTED,
+    [',' - ' ']  = KC_COMMA,
+    ['-' - ' ']  = KC_MINUS,
+    ['.' - ' ']  = KC_DOT,
+    ['/' - ' ']  = KC_SLASH,
+    [':' - ' ']  = KC_SCOLON | SHIFTED,
+    [';' - ' ']  = KC_SCOLON,
+    ['<' - ' ']  = KC_COMMA | SHIFTED,
+    ['=' - ' ']  = KC_EQUAL,
+    ['>' - ' ']  = KC_DOT | SHIFTED,
+    ['?' - ' ']  = KC_SLASH | SHIFTED,
+    ['@' - ' ']  = KC_2 | SHIFTED,
+    ['[' - ' ']  = KC_LBRACKET,
+    ['\\' - ' '] = KC_BSLASH,
+    [']' - ' ']  = KC_RBRACKET,
+    ['^' - ' ']  = KC_6 | SHIFTED,
+    ['_' - ' ']  = KC_MINUS | SHIFTED,
+    ['`' - ' ']  = KC_GRAVE,
+    ['{' - ' ']  = KC_LBRACKET | SHIFTED,
+    ['|' - ' ']  = KC_BSLASH | SHIFTED,
+    ['}' - ' ']  = KC_RBRACKET | SHIFTED,
+    ['~' - ' ']  = KC_GRAVE | SHIFTED
+};
+
+static uint8_t const *m_p_next;                     // Next byte code, NULL when no macro plays.
+static uint8_t m_modifiers;                         // Modifiers held by MACRO_MODS.
+static uint8_t m_keys[MACRO_REPORT_LEN - KEY_SLOT]; // Keys held by MACRO_DOWN, 0 for a free slot.
+static uint8_t m_tapped;                            // Key of last report to release in the next one, 0 if none.
+
+static uint8_t text_code(uint8_t c) {
+    if ('a' <= c && c <= 'z') {
+        return KC_A + (c - 'a');
+    }
+
+    if ('A' <= c && c <= 'Z') {
+        return (KC_A + (c - 'A')) | SHIFTED;
+    }
+
+    if ('1' <= c && c <= '9') {
+        return KC_1 + (c - '1');
+    }
+
+    if (c == '0') {
+        return KC_0;
+    }
+
+    if (c == '\t') {
+        return KC_TAB;
+    }
+
+    if (c == '\n') {
+        return KC_ENTER;
+    }
+
+    if (' ' <= c && c <= '~') {
+        return TEXT_CODES[c - ' '];
+    }
+
+    return KC_NO;
+}
+
+static void key_set(uint8_t key, bool down) {
+    for (size_t i = 0; i < sizeof(m_keys); i++) {
+        if (m_keys[i] == (down ? 0 : key)) {
+            m_keys[i] = down ? key : 0;
+            return;
+        }
+    }
+}
+
+static bool keys_held(void) {
+    for (size_t i = 0; i < sizeof(m_keys); i++) {
+        if (m_keys[i] != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void report_make(uint8_t *p_report, uint8_t modifiers, uint8_t tapped) {
+    memset(p_report, 0, MACRO_REPORT_LEN);
+
+    p_report[0] = modifiers;
+    memcpy(&p_report[KEY_SLOT], m_keys, sizeof(m_keys));
+
+    // A tapped key takes the first free slot, the report is sent as it is if all are taken.
+    for (int i = KEY_SLOT; tapped != 0 && i < MACRO_REPORT_LEN; i++) {
+        if (p_report[i] == 0) {
+            p_report[i] = tapped;
+            break;
+        }
+    }
+}
+
+void macro_start(uint8_t const *p_macro) {
+    m_p_next = p_macro;
+    m_modifiers = 0;
+    m_tapped = 0;
+    memset(m_keys, 0, sizeof(m_keys));
+}
+
+void macro_stop(void) {
+    m_p_next = NULL;
+}
+
+bool macro_is_playing(void) {
+    return m_p_next != NULL;
+}
+
+bool macro_next(uint8_t *p_report) {
+    if (m_p_next == NULL) {
+        return false;
+    }
+
+    // Every tap is let go in its own report, so the same key twice in a row is seen twice.
+    if (m_tapped != 0) {
+        m_tapped = 0;
+        report_make(p_report, m_modifiers, 0);
+        return true;
+    }
+
+    uint8_t byte_code = *m_p_next++;
+
+    // A text byte with no keycode is skipped, the rest of the macro still plays.
+    while (byte_code > MACRO_MODS && text_code(byte_code) == KC_NO) {
+        PORT_LOG_WARNING("Macro byte 0x%X has no keycode, skipped.", byte_code);
+        byte_code = *m_p_next++;
+    }
+
+    switch (byte_code) {
+        case MACRO_TAP:
+            m_tapped = *m_p_next++;
+            report_make(p_report, m_modifiers, m_tapped);
+            return true;
+
+        case MACRO_DOWN:
+            key_set(*m_p_next++, true);
+            report_make(p_report, m_modifiers, 0);
+            return true;
+
+        case MACRO_UP:
+            key_set(*m_p_next++, false);
+            report_make(p_report, m_modifiers, 0);
+            return true;
+
+        case MACRO_MODS:
+            m_modifiers = *m_p_next++;
+            report_make(p_report, m_modifiers, 0);
+            return true;
+
+        default:
+            break;
+    }
+
+    if (byte_code == MACRO_END) {
+        // Anything left down is let go before the macro ends.
+        if (m_modifiers != 0 || keys_held()) {
+            m_modifiers = 0;
+            memset(m_keys, 0, sizeof(m_keys));
+            m_p_next--;
+            report_make(p_report, 0, 0);
+            return true;
+        }
+
+        m_p_next = NULL;
+        return false;
+    }
+
+    uint8_t code = text_code(byte_code);
+
+    m_tapped = code & ~SHIFTED;
+    report_make(p_report, m_modifiers | ((code & SHIFTED) ? MOD_BIT(KC_LSHIFT) : 0), m_tapped);
+
+    return true;
+}
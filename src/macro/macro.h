@@ -0,0 +1,25 @@
+#ifndef _MACRO_H_
+#define _MACRO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Macro player.
+ * A macro is a byte code string in flash, see macro_byte_codes in keycodes.h. Reports are made one at a time when
+ * the caller has room to send one, so a macro of any length plays in constant RAM.
+ */
+
+#define MACRO_REPORT_LEN 8 // Modifiers, reserved byte and 6 keys.
+
+// Starts playing p_macro, a macro already playing is dropped.
+void macro_start(uint8_t const *p_macro);
+
+void macro_stop(void);
+
+bool macro_is_playing(void);
+
+// Writes the next report of the macro. Returns false once the macro has ended, the last report has every key up.
+bool macro_next(uint8_t *p_report);
+
+#endif
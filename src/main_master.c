@@ -7,6 +7,7 @@
 #include "app_timer.h"
 #include "ble_advdata.h"
 #include "ble_advertising.h"
+#include "ble_conn_params.h"
 #include "ble_conn_state.h"
 #include "ble_dis.h"
 #include "ble_err.h"
@@ -24,16 +25,37 @@
 #include "nrf_sdh_ble.h"
 #include "nrf_sdh_soc.h"
 #include "nrf_sdh.h"
+#include "nrf_assert.h"
 #include "nrf.h"
 #include "peer_manager_handler.h"
 #include "peer_manager.h"
 
+#include "config/combos.h"
 #include "config/keyboard.h"
+#include "config/keymap_resolved.h"
+#include "config/macros.h"
+#ifdef DEBUG
 #include "config/keymap.h"
+#endif
+#include "combo/combo.h"
+#include "conn_policy/conn_policy.h"
+#include "cycle_stats/cycle_stats.h"
 #include "error_handler/error_handler.h"
 #include "firmware_config.h"
+#include "hid_report/hid_report.h"
+#include "kb_report_queue/kb_report_queue.h"
+#include "key_event/key_event.h"
+#include "layer_state/layer_state.h"
 #include "low_power/low_power.h"
+#include "macro/macro.h"
+#include "matrix/matrix.h"
+#include "matrix/matrix_strobe_nrf.h"
+#include "mouse_keys/mouse_keys.h"
+#include "pending_report/pending_report.h"
+#include "report_state/report_state.h"
 #include "shared/shared.h"
+#include "tap_hold/tap_hold.h"
+#include "uptime/uptime.h"
 
 #ifdef HAS_SLAVE
 #include "ble_db_discovery.h"
@@ -47,10 +69,13 @@
  */
 // nRF52 variables.
 APP_TIMER_DEF(m_scan_timer_id);
+APP_TIMER_DEF(m_key_timer_id);
+APP_TIMER_DEF(m_mouse_timer_id);
+APP_TIMER_DEF(m_conn_idle_timer_id);
 NRF_BLE_GQ_DEF(m_ble_gatt_queue, NRF_SDH_BLE_CENTRAL_LINK_COUNT, NRF_BLE_GQ_QUEUE_SIZE);
 NRF_BLE_GATT_DEF(m_gatt);
 BLE_ADVERTISING_DEF(m_advertising);
-BLE_HIDS_DEF(m_hids, NRF_SDH_BLE_TOTAL_LINK_COUNT, KB_INPUT_REPORT_MAX_LEN, CC_INPUT_REPORT_MAX_LEN, OUTPUT_REPORT_MAX_LEN);
+BLE_HIDS_DEF(m_hids, NRF_SDH_BLE_TOTAL_LINK_COUNT, KB_INPUT_REPORT_MAX_LEN, CC_INPUT_REPORT_MAX_LEN, NKRO_INPUT_REPORT_MAX_LEN, SYSTEM_INPUT_REPORT_MAX_LEN, MOUSE_INPUT_REPORT_MAX_LEN, OUTPUT_REPORT_MAX_LEN);
 
 #ifdef HAS_SLAVE
 NRF_BLE_SCAN_DEF(m_scan);
@@ -66,23 +91,30 @@ static bool volatile m_fds_initialized = false;
 // HID variables.
 static bool m_hids_in_boot_mode = false; // Current protocol mode.
 static bool m_caps_lock_on = false;      // Variable to indicate if Caps Lock is turned on.
+static bool m_hids_link_ready = false;   // Host takes notifications, set on notifications enabled or bonded link secured.
+static bool m_advertising_idle = false;  // Advertising ran out, typing starts it again.
+
+// Mouse keys variables.
+static uint32_t m_mouse_interval_ticks = 0; // Connection interval, motion is added up and reported at this period.
+static bool m_mouse_timer_running = false;
 
 // Firmware variables.
 const uint8_t ROWS[MATRIX_ROW_NUM] = MATRIX_ROW_PINS;
 const uint8_t COLS[MATRIX_COL_NUM] = MATRIX_COL_PINS;
 const int8_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM] = MATRIX_DEFINE;
 
-static bool m_key_pressed[MATRIX_ROW_NUM][MATRIX_COL_NUM] = {false};
-static int m_debounce[MATRIX_ROW_NUM][MATRIX_COL_NUM];
-static int m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
+STATIC_ASSERT(COMBO_NUM <= COMBO_NUM_MAX);
+STATIC_ASSERT(MACRO_REPORT_LEN == KB_INPUT_REPORT_MAX_LEN);
+STATIC_ASSERT(MOUSE_REPORT_LEN == MOUSE_INPUT_REPORT_MAX_LEN);
 
 typedef enum {
     KEY_TYPE_NOT_TRANSLATED,
-    KEY_TYPE_NO_REPORT,
     KEY_TYPE_KEY,
     KEY_TYPE_MODIFIER,
     KEY_TYPE_KEY_WITH_MODIFIER,
-    KEY_TYPE_CONSUMER
+    KEY_TYPE_CONSUMER,
+    KEY_TYPE_SYSTEM,
+    KEY_TYPE_MOUSE // Code is the mouse keycode.
 } key_type_t;
 
 typedef struct {
@@ -93,21 +125,21 @@ typedef struct {
 typedef union {
     kb_data_t kb;
     uint16_t cc;
+    uint8_t system;
 } key_data_t;
 
 typedef struct {
-    int8_t index;
-    uint8_t source;
-    bool should_delete;
+    uint32_t code; // Resolved key code.
     key_type_t type;
     key_data_t data;
 } key_t;
 
-static key_t m_keys[KEY_NUM];
-static int m_key_count = 0;
+static key_set_t m_translated;          // Keys pressed as far as reports go.
+static key_t m_keys[KEY_INDEX_MAX + 1]; // Translation of each translated key, indexed by key index.
 
-static int8_t m_active_key_index[MASTER_KEY_NUM] = {0};
-static uint16_t m_active_key_index_count = 0;
+#ifdef HAS_SLAVE
+static key_set_t m_slave_pressed; // Keys pressed on slave, as last sent.
+#endif
 
 // Device connection.
 typedef struct {
@@ -134,29 +166,17 @@ static fds_record_desc_t m_device_connection_record_desc = {0};
 static bool m_reset_device_connection_update = false;
 
 // HID report.
-typedef enum {
-    HID_TYPE_KB_REPORT,
-    HID_TYPE_CC_REPORT
-} hid_report_type_t;
-
-typedef union {
-    uint8_t kb[KB_INPUT_REPORT_MAX_LEN];
-    uint16_t cc;
-} hid_report_data_t;
-
 typedef struct {
-    hid_report_type_t type;
-    hid_report_data_t data;
-} hid_report_t;
-
-typedef struct {
-    hid_report_t reports[HID_REPORT_BUFFER_NUM];
+    hid_report_data_t reports[HID_REPORT_BUFFER_NUM];
     int8_t start;
     int8_t end;
     int8_t count;
 } hid_report_buffer_t;
 
-static hid_report_buffer_t m_hid_buffer = {0};
+// One queue or buffer for each report type, served in turn so a type waiting on the host never holds back the others.
+static kb_report_queue_t m_kb_queues[HID_KB_TYPE_NUM];
+static hid_report_buffer_t m_hid_buffers[HID_TYPE_NUM - HID_KB_TYPE_NUM] = {0};
+static hid_report_type_t m_hid_next_type = HID_TYPE_KB_REPORT;
 
 /*
  * Functions declaration.
@@ -185,6 +205,15 @@ static void set_whitelist(void);
 static void advertising_start(void);
 static void timers_start(void);
 static void hids_send_report(hid_report_t *p_report);
+static ret_code_t hid_report_send(hid_report_type_t type, hid_report_data_t *p_data);
+static bool hid_report_put(hid_report_t const *p_report);
+static bool hid_report_peek(hid_report_type_t type, hid_report_data_t *p_data);
+static void hid_report_pop(hid_report_type_t type);
+static bool hid_report_is_empty(hid_report_type_t type);
+static void report_keep(hid_report_t const *p_report);
+static void pending_reports_pump(void);
+static void hids_link_ready(void);
+static void nkro_to_kb_report(uint8_t const *p_nkro, uint8_t *p_kb);
 #ifdef HAS_SLAVE
 static void db_discovery_init(void);
 static void db_disc_handler(ble_db_discovery_evt_t *p_evt);
@@ -196,12 +225,35 @@ static void scan_start(void);
 
 // Firmware functions.
 static void firmware_init(void);
+static void scan_matrix_init(void);
+static void scan_start_task(void *p_data, uint16_t size);
+static void scan_pass_done_handler(void);
 static void scan_matrix_task(void *p_data, uint16_t size);
-static bool update_key_index(int8_t *p_key_index, uint16_t size, uint8_t source);
-static void translate_key_index(void);
+static void matrix_evt_handler(matrix_evt_t const *p_evt);
+static uint32_t key_code_get(key_event_t const *p_event);
+static uint32_t ms_to_ticks(uint32_t ms);
+static void key_event_handler(key_event_t const *p_event, uint32_t code);
+static void key_events_done(void);
+static void key_timeout_handler(void *p_context);
+static void key_timeout_task(void *p_data, uint16_t size);
+static void translate_key_index(uint8_t key_index, uint32_t code);
+static void report_state_apply(key_t const *p_key, bool pressed);
+static void report_flush(void);
+static void macro_report_pump(void);
 static void generate_hid_report(void);
+static void mouse_report_send(void);
+static void mouse_timer_update(void);
+static void mouse_timeout_handler(void *p_context);
+static void mouse_timeout_task(void *p_data, uint16_t size);
+static void conn_idle_init(void);
+static conn_policy_params_t conn_policy_params_of(ble_gap_conn_params_t const *p_params);
+static bool conn_params_request(conn_policy_params_t const *p_params);
+static void conn_idle_timer_start(uint32_t ms);
+static void conn_idle_timeout_handler(void *p_context);
+static void conn_idle_timeout_task(void *p_data, uint16_t size);
 #ifdef HAS_SLAVE
-static void process_slave_key_index(int8_t *p_key_index, uint16_t size);
+static void update_slave_key_index(int8_t const *p_key_index, uint16_t size);
+static void process_slave_key_index(int8_t const *p_key_index, uint16_t size);
 static void clear_slave_key_index(void);
 #endif
 
@@ -227,6 +279,7 @@ int main(void) {
     // Init advertising after all services.
     advertising_init();
     conn_params_init();
+    conn_idle_init();
     peer_manager_init();
     gap_address_init();
     peers_refresh();
@@ -235,6 +288,8 @@ int main(void) {
     // Firmware.
     pins_init();
     firmware_init();
+    scan_matrix_init();
+    uptime_start();
     low_power_mode_init(&m_scan_timer_id, scan_timeout_handler);
 
     // Start.
@@ -264,6 +319,18 @@ static void timers_init(void) {
     // Matrix scan timer.
     err_code = app_timer_create(&m_scan_timer_id, APP_TIMER_MODE_REPEATED, scan_timeout_handler);
     APP_ERROR_CHECK(err_code);
+
+    // Combo window and tap hold term timer.
+    err_code = app_timer_create(&m_key_timer_id, APP_TIMER_MODE_SINGLE_SHOT, key_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    // Mouse keys motion timer.
+    err_code = app_timer_create(&m_mouse_timer_id, APP_TIMER_MODE_REPEATED, mouse_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    // Host link idle timer of the connection policy.
+    err_code = app_timer_create(&m_conn_idle_timer_id, APP_TIMER_MODE_SINGLE_SHOT, conn_idle_timeout_handler);
+    APP_ERROR_CHECK(err_code);
 }
 
 static void scan_timeout_handler(void *p_context) {
@@ -271,7 +338,7 @@ static void scan_timeout_handler(void *p_context) {
 
     ret_code_t err_code;
 
-    err_code = app_sched_event_put(NULL, 0, scan_matrix_task);
+    err_code = app_sched_event_put(NULL, 0, scan_start_task);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -296,6 +363,7 @@ static void ble_stack_init(void) {
 
 static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
     ret_code_t err_code;
+    conn_policy_params_t conn_policy_params;
 
     switch (p_ble_evt->header.evt_id) {
         case BLE_GAP_EVT_CONNECTED:
@@ -305,6 +373,10 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
                 NRF_LOG_INFO("Conn params; conn interval: %i, conn sup timeout: %i.", p_ble_evt->evt.gap_evt.params.connected.conn_params.min_conn_interval * 1.25, p_ble_evt->evt.gap_evt.params.connected.conn_params.conn_sup_timeout * 10);
 
                 m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+                m_mouse_interval_ticks = APP_TIMER_TICKS(1000) * p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval / 800; // In 1.25 ms units.
+
+                conn_policy_params = conn_policy_params_of(&p_ble_evt->evt.gap_evt.params.connected.conn_params);
+                conn_policy_connected(&conn_policy_params);
             }
 #ifdef HAS_SLAVE
             else if (p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_CENTRAL) {
@@ -327,6 +399,22 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
 
         case BLE_GAP_EVT_CONN_PARAM_UPDATE:
             NRF_LOG_INFO("Conn params update; conn interval: %i, conn sup timeout: %i.", p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.min_conn_interval * 1.25, p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.conn_sup_timeout * 10);
+
+            if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle) {
+                m_mouse_interval_ticks = APP_TIMER_TICKS(1000) * p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval / 800; // In 1.25 ms units.
+
+                conn_policy_params = conn_policy_params_of(&p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params);
+                conn_policy_granted(&conn_policy_params);
+
+                // Motion timer takes the new interval.
+                if (m_mouse_timer_running) {
+                    err_code = app_timer_stop(m_mouse_timer_id);
+                    APP_ERROR_CHECK(err_code);
+
+                    m_mouse_timer_running = false;
+                    mouse_timer_update();
+                }
+            }
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
@@ -335,6 +423,11 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
             if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle) {
                 m_conn_handle = BLE_CONN_HANDLE_INVALID;
                 m_peer_id = PM_PEER_ID_INVALID;
+                m_hids_link_ready = false;
+
+                conn_policy_disconnected();
+                macro_stop();
+                mouse_timer_update();
             }
             break;
 
@@ -368,8 +461,14 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
             break;
 
         case BLE_GATTS_EVT_HVN_TX_COMPLETE:
-            if (p_ble_evt->evt.gatts_evt.conn_handle == m_conn_handle && m_hid_buffer.count > 0) {
+            if (p_ble_evt->evt.gatts_evt.conn_handle == m_conn_handle) {
                 hids_send_report(NULL);
+
+                // Next macro reports are made only once a slot is free.
+                macro_report_pump();
+
+                // Motion added up while the slot was taken goes in one report.
+                mouse_report_send();
             }
             break;
 
@@ -409,6 +508,9 @@ static void hids_init(void) {
     ble_hids_init_t hids_init_obj = {0};
     ble_hids_inp_rep_init_t *p_kb_input_report;
     ble_hids_inp_rep_init_t *p_cc_input_report;
+    ble_hids_inp_rep_init_t *p_nkro_input_report;
+    ble_hids_inp_rep_init_t *p_system_input_report;
+    ble_hids_inp_rep_init_t *p_mouse_input_report;
     ble_hids_outp_rep_init_t *p_output_report;
     uint8_t hid_info_flags;
 
@@ -467,15 +569,99 @@ static void hids_init(void) {
         0xA1, 0x01,       // Collection (Application).
         0x85, 0x02,       // Report Id (2).
 
-        // Consumer Control, 1 key at a time.
+        // Consumer Control, CC_USAGE_SLOTS keys at a time.
         0x19, 0x00,       // Usage Minimum (Unassigned).
-        0x2A, 0xFF, 0x00, // Usage Maximum (255).
+        0x2A, 0xFF, 0x03, // Usage Maximum (1023).
         0x15, 0x00,       // Logical Minimum (0).
-        0x26, 0xFF, 0x00, // Logical Maximum (255).
-        0x95, 0x01,       // Report Count (1).
+        0x26, 0xFF, 0x03, // Logical Maximum (1023).
+        0x95, CC_USAGE_SLOTS, // Report Count (CC_USAGE_SLOTS).
         0x75, 0x10,       // Report Size (16).
         0x81, 0x00,       // Input (Data, Array, Absolute).
 
+        0xC0,             // End Collection (Application).
+
+        // NKRO keyboard report.
+        0x05, 0x01,       // Usage Page (Generic Desktop).
+        0x09, 0x06,       // Usage (Keyboard).
+        0xA1, 0x01,       // Collection (Application).
+        0x85, 0x03,       // Report Id (3).
+
+        // Modifiers key, 1 byte to represent 8 keys. 1 bit for 1 key.
+        0x05, 0x07,       // Usage Page (Keyboard).
+        0x19, 0xE0,       // Usage Minimum (Left Control).
+        0x29, 0xE7,       // Usage Maximum (Right Gui).
+        0x15, 0x00,       // Logical Minimum (0).
+        0x25, 0x01,       // Logical Maximum (1).
+        0x95, 0x08,       // Report Count (8).
+        0x75, 0x01,       // Report Size (1).
+        0x81, 0x02,       // Input (Data, Variable, Absolute).
+
+        // Keys bitmap, 1 bit for every usage.
+        0x19, 0x00,       // Usage Minimum (Reserved (No Event Indicated)).
+        0x29, 0xA4,       // Usage Maximum (Keyboard ExSel).
+        0x95, 0xA5,       // Report Count (165).
+        0x75, 0x01,       // Report Size (1).
+        0x81, 0x02,       // Input (Data, Variable, Absolute).
+
+        // Bitmap padding to a whole byte.
+        0x95, 0x03,       // Report Count (3).
+        0x75, 0x01,       // Report Size (1).
+        0x81, 0x01,       // Input (Constant, Array, Absolute).
+
+        0xC0,             // End Collection (Application).
+
+        // System Control report.
+        0x05, 0x01,       // Usage Page (Generic Desktop).
+        0x09, 0x80,       // Usage (System Control).
+        0xA1, 0x01,       // Collection (Application).
+        0x85, 0x04,       // Report Id (4).
+
+        // System Control, 1 key at a time.
+        0x19, 0x00,       // Usage Minimum (Undefined).
+        0x29, 0xB7,       // Usage Maximum (System Speaker Mute).
+        0x15, 0x00,       // Logical Minimum (0).
+        0x26, 0xB7, 0x00, // Logical Maximum (183).
+        0x95, 0x01,       // Report Count (1).
+        0x75, 0x08,       // Report Size (8).
+        0x81, 0x00,       // Input (Data, Array, Absolute).
+
+        0xC0,             // End Collection (Application).
+
+        // Mouse report.
+        0x05, 0x01,       // Usage Page (Generic Desktop).
+        0x09, 0x02,       // Usage (Mouse).
+        0xA1, 0x01,       // Collection (Application).
+        0x85, 0x05,       // Report Id (5).
+        0x09, 0x01,       // Usage (Pointer).
+        0xA1, 0x00,       // Collection (Physical).
+
+        // Buttons, 1 bit for 1 button.
+        0x05, 0x09,       // Usage Page (Button).
+        0x19, 0x01,       // Usage Minimum (Button 1).
+        0x29, 0x05,       // Usage Maximum (Button 5).
+        0x15, 0x00,       // Logical Minimum (0).
+        0x25, 0x01,       // Logical Maximum (1).
+        0x95, 0x05,       // Report Count (5).
+        0x75, 0x01,       // Report Size (1).
+        0x81, 0x02,       // Input (Data, Variable, Absolute).
+
+        // Buttons padding to a whole byte.
+        0x95, 0x01,       // Report Count (1).
+        0x75, 0x03,       // Report Size (3).
+        0x81, 0x01,       // Input (Constant, Array, Absolute).
+
+        // Motion, 1 byte for each axis.
+        0x05, 0x01,       // Usage Page (Generic Desktop).
+        0x09, 0x30,       // Usage (X).
+        0x09, 0x31,       // Usage (Y).
+        0x09, 0x38,       // Usage (Wheel).
+        0x15, 0x81,       // Logical Minimum (-127).
+        0x25, 0x7F,       // Logical Maximum (127).
+        0x95, 0x03,       // Report Count (3).
+        0x75, 0x08,       // Report Size (8).
+        0x81, 0x06,       // Input (Data, Variable, Relative).
+
+        0xC0,             // End Collection (Physical).
         0xC0              // End Collection (Application).
     };
 
@@ -503,6 +689,36 @@ static void hids_init(void) {
     p_cc_input_report->sec.wr = SEC_JUST_WORKS;
     p_cc_input_report->sec.rd = SEC_JUST_WORKS;
 
+    // NKRO keyboard input report.
+    p_nkro_input_report = &input_report_array[NKRO_INPUT_REPORT_INDEX];
+    p_nkro_input_report->max_len = NKRO_INPUT_REPORT_MAX_LEN;
+    p_nkro_input_report->rep_ref.report_id = NKRO_INPUT_REPORT_ID;
+    p_nkro_input_report->rep_ref.report_type = BLE_HIDS_REP_TYPE_INPUT;
+
+    p_nkro_input_report->sec.cccd_wr = SEC_JUST_WORKS;
+    p_nkro_input_report->sec.wr = SEC_JUST_WORKS;
+    p_nkro_input_report->sec.rd = SEC_JUST_WORKS;
+
+    // System Control input report.
+    p_system_input_report = &input_report_array[SYSTEM_INPUT_REPORT_INDEX];
+    p_system_input_report->max_len = SYSTEM_INPUT_REPORT_MAX_LEN;
+    p_system_input_report->rep_ref.report_id = SYSTEM_INPUT_REPORT_ID;
+    p_system_input_report->rep_ref.report_type = BLE_HIDS_REP_TYPE_INPUT;
+
+    p_system_input_report->sec.cccd_wr = SEC_JUST_WORKS;
+    p_system_input_report->sec.wr = SEC_JUST_WORKS;
+    p_system_input_report->sec.rd = SEC_JUST_WORKS;
+
+    // Mouse input report.
+    p_mouse_input_report = &input_report_array[MOUSE_INPUT_REPORT_INDEX];
+    p_mouse_input_report->max_len = MOUSE_INPUT_REPORT_MAX_LEN;
+    p_mouse_input_report->rep_ref.report_id = MOUSE_INPUT_REPORT_ID;
+    p_mouse_input_report->rep_ref.report_type = BLE_HIDS_REP_TYPE_INPUT;
+
+    p_mouse_input_report->sec.cccd_wr = SEC_JUST_WORKS;
+    p_mouse_input_report->sec.wr = SEC_JUST_WORKS;
+    p_mouse_input_report->sec.rd = SEC_JUST_WORKS;
+
     // LEDs output report.
     p_output_report = &output_report_array[OUTPUT_REPORT_INDEX];
     p_output_report->max_len = OUTPUT_REPORT_MAX_LEN;
@@ -573,6 +789,8 @@ static void hids_evt_handler(ble_hids_t *p_hids, ble_hids_evt_t *p_evt) {
 
         case BLE_HIDS_EVT_NOTIF_ENABLED:
             NRF_LOG_INFO("Notify enabled.");
+
+            hids_link_ready();
             break;
 
         default:
@@ -662,6 +880,8 @@ static void adv_evt_handler(const ble_adv_evt_t ble_adv_evt) {
 
         case BLE_ADV_EVT_IDLE:
             NRF_LOG_INFO("Stop advertising.");
+
+            m_advertising_idle = true;
             break;
 
         case BLE_ADV_EVT_WHITELIST_REQUEST:{
@@ -739,6 +959,11 @@ static void pm_evt_handler(pm_evt_t const *p_evt) {
             NRF_LOG_INFO("Connection secured.");
 
             m_peer_id = p_evt->peer_id;
+
+            // A bonded host has its notifications enabled again with the bond, it writes no CCCD.
+            if (p_evt->params.conn_sec_succeeded.procedure == PM_CONN_SEC_PROCEDURE_ENCRYPTION) {
+                hids_link_ready();
+            }
             break;
 
         case PM_EVT_CONN_SEC_CONFIG_REQ: {
@@ -935,6 +1160,8 @@ static void set_whitelist(void) {
 static void advertising_start(void) {
     ret_code_t err_code;
 
+    m_advertising_idle = false;
+
     err_code = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
     APP_ERROR_CHECK(err_code);
 }
@@ -948,52 +1175,237 @@ static void timers_start(void) {
 
 static void hids_send_report(hid_report_t *p_report) {
     ret_code_t err_code;
+    hid_report_data_t data;
+    int empty_buffers = 0;
 
-    if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
-        if (p_report != NULL && m_hid_buffer.count < HID_REPORT_BUFFER_NUM) {
-            memcpy(&m_hid_buffer.reports[m_hid_buffer.end], p_report, sizeof(hid_report_t));
-            m_hid_buffer.count++;
-            m_hid_buffer.end++;
+    // Reports wait behind pending ones, mouse reports have no order to keep with them. A keyboard report that finds
+    // no room in its queue waits too, so no transition is lost.
+    if (p_report != NULL) {
+        conn_policy_activity();
 
-            if (m_hid_buffer.end >= HID_REPORT_BUFFER_NUM) {
-                m_hid_buffer.end = 0;
-            }
+        bool in_order = pending_report_count() == 0 || p_report->type == HID_TYPE_MOUSE_REPORT;
+
+        if (!m_hids_link_ready || !in_order || !hid_report_put(p_report)) {
+            report_keep(p_report);
         }
+    }
 
-        while (m_hid_buffer.count > 0) {
-            err_code = NRF_SUCCESS;
-            hid_report_type_t report_type = m_hid_buffer.reports[m_hid_buffer.start].type;
+    if (!m_hids_link_ready) {
+        return;
+    }
 
-            if (m_hids_in_boot_mode) {
-                if (report_type == HID_TYPE_KB_REPORT) {
-                    err_code = ble_hids_boot_kb_inp_rep_send(&m_hids, KB_INPUT_REPORT_MAX_LEN, (uint8_t *)&m_hid_buffer.reports[m_hid_buffer.start].data.kb, m_conn_handle);
-                } else if (report_type == HID_TYPE_CC_REPORT) {
-                    err_code = NRF_ERROR_RESOURCES;
-                }
-            } else if (report_type == HID_TYPE_KB_REPORT) {
-                err_code = ble_hids_inp_rep_send(&m_hids, KB_INPUT_REPORT_INDEX, KB_INPUT_REPORT_MAX_LEN, (uint8_t *)&m_hid_buffer.reports[m_hid_buffer.start].data.kb, m_conn_handle);
-            } else if (report_type == HID_TYPE_CC_REPORT) {
-                err_code = ble_hids_inp_rep_send(&m_hids, CC_INPUT_REPORT_INDEX, CC_INPUT_REPORT_MAX_LEN, (uint8_t *)&m_hid_buffer.reports[m_hid_buffer.start].data.cc, m_conn_handle);
-            }
+    // Buffers take turns, one report each, until all are empty or the SoftDevice has no slot left.
+    while (empty_buffers < HID_TYPE_NUM) {
+        pending_reports_pump();
 
-            NRF_LOG_INFO("HIDs report; ret: 0x%X.", err_code);
+        hid_report_type_t report_type = m_hid_next_type;
 
-            if (err_code != NRF_ERROR_RESOURCES) {
-                m_hid_buffer.count--;
-                m_hid_buffer.start++;
+        m_hid_next_type = (report_type + 1) % HID_TYPE_NUM;
 
-                if (m_hid_buffer.start >= HID_REPORT_BUFFER_NUM) {
-                    m_hid_buffer.start = 0;
-                }
-            } else if (err_code == NRF_ERROR_RESOURCES) {
-                break;
-            }
+        if (!hid_report_peek(report_type, &data)) {
+            empty_buffers++;
+            continue;
+        }
 
-            NRF_LOG_INFO("HIDs report queue: %i", m_hid_buffer.count);
+        empty_buffers = 0;
 
-            if (err_code != NRF_SUCCESS && err_code != NRF_ERROR_INVALID_STATE && err_code != NRF_ERROR_RESOURCES && err_code != NRF_ERROR_BUSY && err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING && err_code != NRF_ERROR_FORBIDDEN) {
-                APP_ERROR_CHECK(err_code);
-            }
+        err_code = hid_report_send(report_type, &data);
+
+        NRF_LOG_INFO("HIDs report; type: %d, ret: 0x%X.", report_type, err_code);
+
+        if (err_code == NRF_ERROR_RESOURCES) {
+            // Slots are shared by every report, this type goes first on HVN_TX_COMPLETE.
+            m_hid_next_type = report_type;
+            break;
+        }
+
+        hid_report_pop(report_type);
+
+        if (err_code != NRF_SUCCESS && err_code != NRF_ERROR_INVALID_STATE && err_code != NRF_ERROR_BUSY && err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING && err_code != NRF_ERROR_FORBIDDEN) {
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+}
+
+// Returns false if a keyboard queue has no room for the report.
+static bool hid_report_put(hid_report_t const *p_report) {
+    if (p_report->type < HID_KB_TYPE_NUM) {
+        return kb_report_queue_put(&m_kb_queues[p_report->type], p_report->data.kb);
+    }
+
+    hid_report_buffer_t *p_buffer = &m_hid_buffers[p_report->type - HID_KB_TYPE_NUM];
+
+    // A full buffer has its newest report replaced, the last report sent is always the state as it stands.
+    if (p_buffer->count == HID_REPORT_BUFFER_NUM) {
+        p_buffer->count--;
+        p_buffer->end = (p_buffer->end + HID_REPORT_BUFFER_NUM - 1) % HID_REPORT_BUFFER_NUM;
+    }
+
+    memcpy(&p_buffer->reports[p_buffer->end], &p_report->data, sizeof(hid_report_data_t));
+    p_buffer->count++;
+    p_buffer->end++;
+
+    if (p_buffer->end >= HID_REPORT_BUFFER_NUM) {
+        p_buffer->end = 0;
+    }
+
+    return true;
+}
+
+static bool hid_report_peek(hid_report_type_t type, hid_report_data_t *p_data) {
+    if (type < HID_KB_TYPE_NUM) {
+        return kb_report_queue_peek(&m_kb_queues[type], p_data->kb);
+    }
+
+    hid_report_buffer_t *p_buffer = &m_hid_buffers[type - HID_KB_TYPE_NUM];
+
+    if (p_buffer->count == 0) {
+        return false;
+    }
+
+    memcpy(p_data, &p_buffer->reports[p_buffer->start], sizeof(hid_report_data_t));
+
+    return true;
+}
+
+static void hid_report_pop(hid_report_type_t type) {
+    if (type < HID_KB_TYPE_NUM) {
+        kb_report_queue_pop(&m_kb_queues[type]);
+        return;
+    }
+
+    hid_report_buffer_t *p_buffer = &m_hid_buffers[type - HID_KB_TYPE_NUM];
+
+    p_buffer->count--;
+    p_buffer->start++;
+
+    if (p_buffer->start >= HID_REPORT_BUFFER_NUM) {
+        p_buffer->start = 0;
+    }
+
+    NRF_LOG_INFO("HIDs report queue: %i", p_buffer->count);
+}
+
+static bool hid_report_is_empty(hid_report_type_t type) {
+    if (type < HID_KB_TYPE_NUM) {
+        return kb_report_queue_is_empty(&m_kb_queues[type]);
+    }
+
+    return m_hid_buffers[type - HID_KB_TYPE_NUM].count == 0;
+}
+
+static void report_keep(hid_report_t const *p_report) {
+    // Typing wakes advertising that ran out.
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID && m_advertising_idle) {
+        advertising_start();
+    }
+
+    // Motion made while the link is down is of no use once it is up.
+    if (p_report->type == HID_TYPE_MOUSE_REPORT) {
+        return;
+    }
+
+    if (m_hids_link_ready) {
+        pending_report_hold(p_report);
+    } else {
+        pending_report_put(p_report, uptime_ms_get());
+    }
+}
+
+// Pending reports go into the queue of their type only while it is empty, so replaying them never makes a queue
+// coalesce.
+static void pending_reports_pump(void) {
+    hid_report_t const *p_pending;
+
+    while ((p_pending = pending_report_peek()) != NULL) {
+        if (!hid_report_is_empty(p_pending->type)) {
+            return;
+        }
+
+        if (!hid_report_put(p_pending)) {
+            return;
+        }
+
+        pending_report_pop();
+    }
+}
+
+static void hids_link_ready(void) {
+    if (m_hids_link_ready) {
+        return;
+    }
+
+    m_hids_link_ready = true;
+
+    // The host starts with no key down.
+    kb_report_queue_init(&m_kb_queues[HID_TYPE_KB_REPORT], false);
+    kb_report_queue_init(&m_kb_queues[HID_TYPE_NKRO_REPORT], true);
+    memset(m_hid_buffers, 0, sizeof(m_hid_buffers));
+    m_hid_next_type = HID_TYPE_KB_REPORT;
+
+    pending_report_expire(uptime_ms_get());
+
+    NRF_LOG_INFO("HIDs link ready; pending reports: %i.", pending_report_count());
+
+    hids_send_report(NULL);
+
+    // Keys held since before the link went down are reported again.
+    report_state_kb_resend();
+    generate_hid_report();
+    macro_report_pump();
+}
+
+// Reports the host cannot take in its protocol mode are dropped with NRF_ERROR_INVALID_STATE.
+static ret_code_t hid_report_send(hid_report_type_t type, hid_report_data_t *p_data) {
+    if (m_hids_in_boot_mode) {
+        uint8_t kb[KB_INPUT_REPORT_MAX_LEN];
+
+        switch (type) {
+            case HID_TYPE_KB_REPORT:
+                return ble_hids_boot_kb_inp_rep_send(&m_hids, KB_INPUT_REPORT_MAX_LEN, p_data->kb, m_conn_handle);
+
+            case HID_TYPE_NKRO_REPORT:
+                // Queued before the host went to boot protocol.
+                nkro_to_kb_report(p_data->nkro, kb);
+                return ble_hids_boot_kb_inp_rep_send(&m_hids, KB_INPUT_REPORT_MAX_LEN, kb, m_conn_handle);
+
+            default:
+                // Boot protocol has no consumer, system or mouse report.
+                return NRF_ERROR_INVALID_STATE;
+        }
+    }
+
+    switch (type) {
+        case HID_TYPE_KB_REPORT:
+            return ble_hids_inp_rep_send(&m_hids, KB_INPUT_REPORT_INDEX, KB_INPUT_REPORT_MAX_LEN, p_data->kb, m_conn_handle);
+
+        case HID_TYPE_CC_REPORT:
+            return ble_hids_inp_rep_send(&m_hids, CC_INPUT_REPORT_INDEX, CC_INPUT_REPORT_MAX_LEN, (uint8_t *)p_data->cc, m_conn_handle);
+
+        case HID_TYPE_NKRO_REPORT:
+            return ble_hids_inp_rep_send(&m_hids, NKRO_INPUT_REPORT_INDEX, NKRO_INPUT_REPORT_MAX_LEN, p_data->nkro, m_conn_handle);
+
+        case HID_TYPE_SYSTEM_REPORT:
+            return ble_hids_inp_rep_send(&m_hids, SYSTEM_INPUT_REPORT_INDEX, SYSTEM_INPUT_REPORT_MAX_LEN, &p_data->system, m_conn_handle);
+
+        case HID_TYPE_MOUSE_REPORT:
+            return ble_hids_inp_rep_send(&m_hids, MOUSE_INPUT_REPORT_INDEX, MOUSE_INPUT_REPORT_MAX_LEN, p_data->mouse, m_conn_handle);
+
+        default:
+            return NRF_ERROR_INVALID_STATE;
+    }
+}
+
+// Modifiers and the first six keys of a bitmap report.
+static void nkro_to_kb_report(uint8_t const *p_nkro, uint8_t *p_kb) {
+    int kb_report_index = 2;
+
+    memset(p_kb, 0, KB_INPUT_REPORT_MAX_LEN);
+    p_kb[0] = p_nkro[0];
+
+    for (int usage = 0; usage <= NKRO_USAGE_MAX && kb_report_index < KB_INPUT_REPORT_MAX_LEN; usage++) {
+        if (p_nkro[1 + usage / 8] & (1U << (usage % 8))) {
+            p_kb[kb_report_index++] = usage;
         }
     }
 }
@@ -1104,332 +1516,586 @@ static void scan_start(void) {
 static void firmware_init(void) {
     NRF_LOG_INFO("firmware_init.");
 
-    // Init m_keys array.
+    // Init key state.
+    memset(&m_translated, 0, sizeof(m_translated));
     memset(&m_keys, 0, sizeof(m_keys));
+#ifdef HAS_SLAVE
+    memset(&m_slave_pressed, 0, sizeof(m_slave_pressed));
+#endif
+    layer_state_init();
+    report_state_init();
+    kb_report_queue_init(&m_kb_queues[HID_TYPE_KB_REPORT], false);
+    kb_report_queue_init(&m_kb_queues[HID_TYPE_NKRO_REPORT], true);
+    pending_report_init();
+
+    mouse_keys_init_t mouse_keys_init_params = {0};
+
+    mouse_keys_init_params.ticks_get = ms_to_ticks;
+
+    mouse_keys_init(&mouse_keys_init_params);
+
+    tap_hold_init_t tap_hold_init_params = {0};
+
+    tap_hold_init_params.code_get = key_code_get;
+    tap_hold_init_params.evt_handler = key_event_handler;
+    tap_hold_init_params.ticks_get = ms_to_ticks;
 
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        for (int j = 0; j < MATRIX_COL_NUM; j++) {
-            m_debounce[i][j] = KEY_PRESS_DEBOUNCE;
+    tap_hold_init(&tap_hold_init_params);
+
+    combo_init_t combo_init_params = {0};
+
+    combo_init_params.p_combos = COMBOS;
+    combo_init_params.combo_num = COMBO_NUM;
+    combo_init_params.evt_handler = tap_hold_event_process;
+    combo_init_params.ticks_get = ms_to_ticks;
+
+    combo_init(&combo_init_params);
+
+#ifdef DEBUG
+    // Resolved keymap must be regenerated after every change of keymap.h.
+    ASSERT(KEYMAP_LAYER_NUM == sizeof(KEYMAP) / sizeof(KEYMAP[0]));
+
+    for (int layer = 0; layer < KEYMAP_LAYER_NUM; layer++) {
+        for (int index = 0; index < KEY_INDEX_MAX; index++) {
+            int from = layer;
+
+            while (from > 0 && KEYMAP[from][index] == KC_TRANSPARENT) {
+                from--;
+            }
+
+            ASSERT(keymap_code_get(layer, index) == (KEYMAP[from][index] == KC_TRANSPARENT ? KC_NO : KEYMAP[from][index]));
         }
     }
+#endif
+
+    CYCLE_STATS_INIT();
 }
 
-static void scan_matrix_task(void *p_data, uint16_t size) {
+static void scan_matrix_init(void) {
+    matrix_init_t init = {0};
+
+    init.p_backend = &MATRIX_STROBE_NRF_BACKEND;
+    init.pass_done_handler = scan_pass_done_handler;
+    init.evt_handler = matrix_evt_handler;
+    init.timestamp_get = app_timer_cnt_get;
+
+    matrix_init(&init);
+}
+
+static void scan_start_task(void *p_data, uint16_t size) {
     UNUSED_PARAMETER(p_data);
     UNUSED_PARAMETER(size);
 
+    // A tick queued before rows went to sense must not drive columns.
+    if (low_power_mode_is_active()) {
+        return;
+    }
+
+    // If previous pass is still in progress, this tick is skipped.
+    matrix_scan_start();
+}
+
+static void scan_pass_done_handler(void) {
     ret_code_t err_code;
-    bool has_key_press = false;
-    bool has_key_release = false;
 
-    for (int col = 0; col < MATRIX_COL_NUM; col++) {
-        nrf_gpio_pin_set(COLS[col]);
-        nrf_delay_us(PIN_SET_DELAY);
+    // Called from settle timer interrupt, process the pass in main context.
+    err_code = app_sched_event_put(NULL, 0, scan_matrix_task);
+    APP_ERROR_CHECK(err_code);
+}
 
-        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
-            bool pressed = nrf_gpio_pin_read(ROWS[row]) > 0;
+static void scan_matrix_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
 
-            if (m_key_pressed[row][col] == pressed) {
-                if (pressed) {
-                    m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-                } else {
-                    m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
-                }
-            } else {
-                if (m_debounce[row][col] <= 0) {
-                    if (pressed) {
-                        // On key press.
-                        m_key_pressed[row][col] = true;
-                        m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-                        has_key_press = true;
-
-                        if (m_active_key_index_count < MASTER_KEY_NUM) {
-                            int i = 0;
-
-                            while (i < m_active_key_index_count && m_active_key_index[i] != MATRIX[row][col]) {
-                                i++;
-                            }
-
-                            if (i == m_active_key_index_count) {
-                                m_active_key_index[m_active_key_index_count++] = MATRIX[row][col];
-                            }
-                        }
-                    } else {
-                        // On key release.
-                        m_key_pressed[row][col] = false;
-                        m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
-                        has_key_release = true;
-                        int i = 0;
-
-                        while (i < m_active_key_index_count && m_active_key_index[i] != MATRIX[row][col]) {
-                            i++;
-                        }
-
-                        if (i < m_active_key_index_count) {
-                            while (i < m_active_key_index_count) {
-                                m_active_key_index[i] = m_active_key_index[i + 1];
-                                i++;
-                            }
-
-                            m_active_key_index_count--;
-                        }
-                    }
-                } else {
-                    m_debounce[row][col] -= SCAN_DELAY;
-                }
-            }
-        }
+    CYCLE_STATS_BEGIN(scan);
 
-        nrf_gpio_pin_clear(COLS[col]);
-    }
+    bool key_changed = matrix_scan_step();
 
-    if (has_key_press || has_key_release) {
-        update_key_index((int8_t *)&m_active_key_index, m_active_key_index_count, SOURCE);
-        translate_key_index();
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-    } else {
-        m_low_power_mode_counter -= SCAN_DELAY;
+    // Pick the next scan period, or wait on row sense until next press.
+    low_power_scan_update(key_changed || !matrix_is_settled(), matrix_is_idle());
+
+    CYCLE_STATS_END(scan, CYCLE_STATS_SCAN);
+}
+
+static void matrix_evt_handler(matrix_evt_t const *p_evt) {
+    if (p_evt->type != MATRIX_EVT_KEYS_CHANGED) {
+        return;
     }
 
-    if (m_low_power_mode_counter <= 0) {
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-        low_power_mode_start();
+    key_event_t event;
+
+    CYCLE_STATS_BEGIN(update);
+
+    while (key_event_get(&event)) {
+        combo_event_process(&event);
     }
+
+    CYCLE_STATS_END(update, CYCLE_STATS_UPDATE);
+
+    key_events_done();
 }
 
-static bool update_key_index(int8_t *p_key_index, uint16_t size, uint8_t source) {
-    // Mark all keys from this source as should delete.
-    for (int i = 0; i < m_key_count; i++) {
-        if (m_keys[i].source == source) {
-            m_keys[i].should_delete = true;
-        }
+static uint32_t key_code_get(key_event_t const *p_event) {
+    if (p_event->combo != 0) {
+        return combo_code_get(p_event->combo);
     }
 
-    // Update all ke presented in p_key_index.
-    for (int i = 0; i < size; i++) {
-        int j = 0;
+    // Key resolves once on the layer active when its press leaves the tap hold engine.
+    return keymap_code_get(layer_state_highest(), p_event->key_index - 1);
+}
 
-        while (j < m_key_count && m_keys[j].index != p_key_index[i]) {
-            j++;
-        }
+static uint32_t ms_to_ticks(uint32_t ms) {
+    return APP_TIMER_TICKS(ms);
+}
 
-        if (j < m_key_count) {
-            m_keys[j].should_delete = false;
-        } else if (m_key_count < KEY_NUM) {
-            key_t key = {0};
-            key.index = p_key_index[i];
-            key.source = source;
-            m_keys[m_key_count++] = key;
-        }
+static void key_event_handler(key_event_t const *p_event, uint32_t code) {
+    key_t *p_key = &m_keys[p_event->key_index];
+
+    if (p_event->pressed) {
+        CYCLE_STATS_BEGIN(translate);
+        translate_key_index(p_event->key_index, code);
+        report_state_apply(p_key, true);
+        CYCLE_STATS_END(translate, CYCLE_STATS_TRANSLATE);
+
+        key_set_add(&m_translated, p_event->key_index);
+        return;
     }
 
-    // Remove all key that is should_delete.
-    int i = 0;
+    // A tap comes as press and release at once, the press must be reported before it is released.
+    report_flush();
 
-    while (i < m_key_count) {
-        while (!m_keys[i].should_delete && i < m_key_count) {
-            i++;
-        }
+    if (key_set_has(&m_translated, p_event->key_index)) {
+        report_state_apply(p_key, false);
+    }
 
-        if (i < m_key_count) {
-            for (int j = i; j < m_key_count - 1; j++) {
-                m_keys[j] = m_keys[j + 1];
-            }
+    layer_state_key(p_key->code, false);
+    memset(p_key, 0, sizeof(key_t));
 
-            m_key_count--;
-        }
+    key_set_remove(&m_translated, p_event->key_index);
+}
+
+static void key_events_done(void) {
+    ret_code_t err_code;
+    uint32_t now = app_timer_cnt_get();
+    uint32_t deadline;
+
+    uint32_t ticks = UINT32_MAX;
+
+    combo_tick(now);
+    tap_hold_tick(now);
+    report_flush();
+
+    // Held back presses are decided when their combo window or tap hold term runs out, unless an event decides them
+    // first.
+    err_code = app_timer_stop(m_key_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    if (combo_deadline_get(&deadline)) {
+        ticks = app_timer_cnt_diff_compute(deadline, now);
+    }
+
+    if (tap_hold_deadline_get(&deadline)) {
+        ticks = MIN(ticks, app_timer_cnt_diff_compute(deadline, now));
+    }
+
+    if (ticks != UINT32_MAX) {
+        err_code = app_timer_start(m_key_timer_id, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+        APP_ERROR_CHECK(err_code);
     }
 }
 
-static void translate_key_index(void) {
+static void key_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
     ret_code_t err_code;
-    uint8_t layer = _BASE_LAYER;
 
-    for (int i = 0; i < m_key_count; i++) {
-        if (m_keys[i].type != KEY_TYPE_NOT_TRANSLATED) {
-            continue;
-        }
+    err_code = app_sched_event_put(NULL, 0, key_timeout_task);
+    APP_ERROR_CHECK(err_code);
+}
 
-        int8_t index = m_keys[i].index - 1;
-        uint32_t code = KEYMAP[layer][index];
+static void key_timeout_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
 
-        if (IS_LAYER(code)) {
-            layer = LAYER(code);
-            continue;
-        }
+    key_events_done();
+}
 
-        if (code == KC_TRANSPARENT) {
-            m_keys[i].type = KEY_TYPE_NO_REPORT;
-            uint8_t temp_layer = layer;
+static void translate_key_index(uint8_t key_index, uint32_t code) {
+    ret_code_t err_code;
+    key_t *p_key = &m_keys[key_index];
 
-            while (temp_layer >= 0 && KEYMAP[temp_layer][index] == KC_TRANSPARENT) {
-                temp_layer--;
-            }
+    p_key->code = code;
 
-            if (temp_layer < 0) {
-                continue;
-            } else {
-                code = KEYMAP[temp_layer][index];
-            }
-        }
+    if (layer_state_key(code, true)) {
+        return;
+    }
 
-        if (IS_MOD(code)) {
-            m_keys[i].type = KEY_TYPE_MODIFIER;
-            m_keys[i].data.kb.modifiers = MOD_BIT(code);
+    layer_state_key_resolved();
 
-            code = MOD_CODE(code);
+    if (IS_MACRO(code)) {
+        if (MACRO_INDEX(code) < MACRO_NUM) {
+            // Changes so far go out before the macro holds back reports of keys.
+            report_flush();
+
+            macro_start(MACROS[MACRO_INDEX(code)]);
+            macro_report_pump();
         }
 
-        if (IS_KEY(code)) {
-            if (m_keys[i].type == KEY_TYPE_MODIFIER) {
-                m_keys[i].type = KEY_TYPE_KEY_WITH_MODIFIER;
-            } else {
-                m_keys[i].type = KEY_TYPE_KEY;
-            }
+        return;
+    }
 
-            m_keys[i].data.kb.key = code;
-            continue;
-        }
+    if (IS_MOD(code)) {
+        p_key->type = KEY_TYPE_MODIFIER;
+        p_key->data.kb.modifiers = MOD_BIT(code);
 
-        if (IS_CONSUMER(code)) {
-            m_keys[i].type = KEY_TYPE_CONSUMER;
-            m_keys[i].data.cc = CONSUMER_CODE(code);
+        code = MOD_CODE(code);
+    }
+
+    if (IS_KEY(code)) {
+        if (p_key->type == KEY_TYPE_MODIFIER) {
+            p_key->type = KEY_TYPE_KEY_WITH_MODIFIER;
+        } else {
+            p_key->type = KEY_TYPE_KEY;
         }
 
-        if (IS_DEVICE_CONNECTION(code)) {
-            NRF_LOG_INFO("Device connection.");
+        p_key->data.kb.key = code;
+        return;
+    }
 
-            if (IS_DEVICE_SWITCHING(code)) {
-                uint8_t device = DEVICE(code);
+    if (IS_CONSUMER(code)) {
+        p_key->type = KEY_TYPE_CONSUMER;
+        p_key->data.cc = CONSUMER_CODE(code);
+    }
 
-                NRF_LOG_INFO("Switching to device %u.", device);
+    if (IS_SYSTEM(code)) {
+        p_key->type = KEY_TYPE_SYSTEM;
+        p_key->data.system = SYSTEM_CODE(code);
+    }
 
-                if (device != m_device_connection.current_device) {
-                    m_device_connection.current_device = device;
+    if (IS_MOUSE(code)) {
+        p_key->type = KEY_TYPE_MOUSE;
+    }
 
-                    m_reset_device_connection_update = true;
-                    err_code = fds_record_update(&m_device_connection_record_desc, &m_device_connection_record);
-                    APP_ERROR_CHECK(err_code);
-                } else {
-                    reset_device();
-                }
+    if (IS_DEVICE_CONNECTION(code)) {
+        NRF_LOG_INFO("Device connection.");
+
+        if (IS_DEVICE_SWITCHING(code)) {
+            uint8_t device = DEVICE(code);
+
+            NRF_LOG_INFO("Switching to device %u.", device);
+
+            if (device != m_device_connection.current_device) {
+                m_device_connection.current_device = device;
+
+                m_reset_device_connection_update = true;
+                err_code = fds_record_update(&m_device_connection_record_desc, &m_device_connection_record);
+                APP_ERROR_CHECK(err_code);
+            } else {
+                reset_device();
             }
+        }
+
+        if (IS_DEVICE_CONNECT(code)) {
+            NRF_LOG_INFO("Reconnect device.");
 
-            if (IS_DEVICE_CONNECT(code)) {
-                NRF_LOG_INFO("Reconnect device.");
+            uint8_t bytes_available;
+            uint8_t new_addr;
 
-                uint8_t bytes_available;
-                uint8_t new_addr;
+            // Generate new unique address for current device.
+            do {
+                err_code = sd_rand_application_bytes_available_get(&bytes_available);
+                APP_ERROR_CHECK(err_code);
+
+                while (bytes_available < 1) {
+                    nrf_delay_ms(OPERATION_DELAY);
 
-                // Generate new unique address for current device.
-                do {
                     err_code = sd_rand_application_bytes_available_get(&bytes_available);
                     APP_ERROR_CHECK(err_code);
+                }
 
-                    while (bytes_available < 1) {
-                        nrf_delay_ms(OPERATION_DELAY);
+                err_code = sd_rand_application_vector_get(&new_addr, 1);
+                APP_ERROR_CHECK(err_code);
+            } while (new_addr == m_device_connection.addrs[0] || new_addr == m_device_connection.addrs[1] || new_addr == m_device_connection.addrs[2]); // To ensure new unique address.
 
-                        err_code = sd_rand_application_bytes_available_get(&bytes_available);
-                        APP_ERROR_CHECK(err_code);
-                    }
+            // Save the generated address.
+            m_device_connection.addrs[m_device_connection.current_device] = new_addr;
 
-                    err_code = sd_rand_application_vector_get(&new_addr, 1);
-                    APP_ERROR_CHECK(err_code);
-                } while (new_addr == m_device_connection.addrs[0] || new_addr == m_device_connection.addrs[1] || new_addr == m_device_connection.addrs[2]); // To ensure new unique address.
+            // Reset peer id for current device.
+            m_device_connection.peer_ids[m_device_connection.current_device] = PM_PEER_ID_INVALID;
 
-                // Save the generated address.
-                m_device_connection.addrs[m_device_connection.current_device] = new_addr;
+            m_reset_device_connection_update = true;
+            err_code = fds_record_update(&m_device_connection_record_desc, &m_device_connection_record);
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+}
 
-                // Reset peer id for current device.
-                m_device_connection.peer_ids[m_device_connection.current_device] = PM_PEER_ID_INVALID;
+// Only the parts of the reports a key touches are updated.
+static void report_state_apply(key_t const *p_key, bool pressed) {
+    if (p_key->type == KEY_TYPE_MODIFIER || p_key->type == KEY_TYPE_KEY_WITH_MODIFIER) {
+        report_state_modifiers(p_key->data.kb.modifiers, pressed);
+    }
 
-                m_reset_device_connection_update = true;
-                err_code = fds_record_update(&m_device_connection_record_desc, &m_device_connection_record);
-                APP_ERROR_CHECK(err_code);
-            }
-        }
+    if (p_key->type == KEY_TYPE_KEY || p_key->type == KEY_TYPE_KEY_WITH_MODIFIER) {
+        report_state_key(p_key->data.kb.key, pressed);
+    }
+
+    if (p_key->type == KEY_TYPE_CONSUMER) {
+        report_state_consumer(p_key->data.cc, pressed);
+    }
+
+    if (p_key->type == KEY_TYPE_SYSTEM) {
+        report_state_system(p_key->data.system, pressed);
     }
 
-    // Schedule hid report.
+    if (p_key->type == KEY_TYPE_MOUSE) {
+        mouse_keys_key(p_key->code, pressed, app_timer_cnt_get());
+    }
+}
+
+static void report_flush(void) {
+    if (macro_is_playing()) {
+        return;
+    }
+
+    CYCLE_STATS_BEGIN(generate);
     generate_hid_report();
+    CYCLE_STATS_END(generate, CYCLE_STATS_GENERATE);
 }
 
+static void macro_report_pump(void) {
+    hid_report_t report = {0};
 
-static void generate_hid_report(void) {
-    static bool empty_kb_report_sent = true;
-    int kb_report_index = 2;
-    hid_report_t kb_report = {0};
-    kb_report.type = HID_TYPE_KB_REPORT;
+    report.type = HID_TYPE_KB_REPORT;
 
-    static bool empty_cc_report_sent = true;
-    hid_report_t cc_report = {0};
-    cc_report.type = HID_TYPE_CC_REPORT;
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+        macro_stop();
+    }
 
-    for (int i = 0; i < m_key_count; i++) {
-        if (m_keys[i].type == KEY_TYPE_NOT_TRANSLATED || m_keys[i].type == KEY_TYPE_NO_REPORT) {
-            continue;
+    // Reports go straight to the SoftDevice while it takes them. Once it is full, one report waits in the buffer and
+    // the rest of the macro stays in flash until HVN_TX_COMPLETE. A macro made before the link is ready waits for it.
+    while (macro_is_playing() && m_hids_link_ready && pending_report_count() == 0 && hid_report_is_empty(HID_TYPE_KB_REPORT)) {
+        if (!macro_next(report.data.kb)) {
+            // Keys held through the macro are reported again.
+            report_state_kb_resend();
+            report_flush();
+            return;
         }
 
-        if (m_keys[i].type == KEY_TYPE_MODIFIER || m_keys[i].type == KEY_TYPE_KEY_WITH_MODIFIER) {
-            kb_report.data.kb[0] |= m_keys[i].data.kb.modifiers;
-        }
+        hids_send_report(&report);
+    }
+}
 
-        if ((m_keys[i].type == KEY_TYPE_KEY || m_keys[i].type == KEY_TYPE_KEY_WITH_MODIFIER) && kb_report_index < KB_INPUT_REPORT_MAX_LEN) {
-            kb_report.data.kb[kb_report_index++] = m_keys[i].data.kb.key;
-        }
+// The bitmap report is left to report protocol hosts on links whose ATT MTU fits it.
+static bool nkro_is_active(void) {
+    return !m_hids_in_boot_mode && nrf_ble_gatt_eff_mtu_get(&m_gatt, m_conn_handle) >= NKRO_INPUT_REPORT_MAX_LEN + 3; // Opcode and handle.
+}
 
-        if (m_keys[i].type == KEY_TYPE_CONSUMER) {
-            cc_report.data.cc = m_keys[i].data.cc;
+static void generate_hid_report(void) {
+    static hid_report_type_t kb_report_type = HID_TYPE_KB_REPORT;
+    static bool kb_report_held = false; // Last keyboard report sent had a key down.
+    hid_report_t report = {0};
+
+    report.type = nkro_is_active() ? HID_TYPE_NKRO_REPORT : HID_TYPE_KB_REPORT;
+
+    // Keys still down in the report of the other kind are let go when the kind changes.
+    if (report.type != kb_report_type) {
+        if (kb_report_held) {
+            hid_report_t empty_report = {0};
+            empty_report.type = kb_report_type;
+
+            hids_send_report(&empty_report);
         }
+
+        kb_report_type = report.type;
+        report_state_kb_resend();
     }
 
-    bool is_empty_kb_report = kb_report.data.kb[0] == 0 && kb_report_index == 2;
+    if (report.type == HID_TYPE_NKRO_REPORT ? report_state_nkro_take(report.data.nkro) : report_state_kb_take(report.data.kb)) {
+        kb_report_held = !report_state_kb_is_empty();
 
-    if (!empty_kb_report_sent || !is_empty_kb_report) {
-        empty_kb_report_sent = is_empty_kb_report;
+        NRF_LOG_INFO("generate_hid_report; kb%s", report.type == HID_TYPE_NKRO_REPORT ? " nkro" : "");
 
-        NRF_LOG_INFO("generate_hid_report; kb len: %d", kb_report_index - 2);
+        hids_send_report(&report);
+    }
 
-        hids_send_report(&kb_report);
+    memset(&report, 0, sizeof(report));
+    report.type = HID_TYPE_CC_REPORT;
+
+    if (report_state_cc_take(report.data.cc)) {
+        NRF_LOG_INFO("generate_hid_report; cc: 0x%04x", report.data.cc[0]);
+
+        hids_send_report(&report);
+    }
+
+    memset(&report, 0, sizeof(report));
+    report.type = HID_TYPE_SYSTEM_REPORT;
+
+    if (report_state_system_take(&report.data.system)) {
+        NRF_LOG_INFO("generate_hid_report; system: 0x%02x", report.data.system);
+
+        hids_send_report(&report);
+    }
+
+    mouse_report_send();
+}
+
+static void mouse_report_send(void) {
+    hid_report_t report = {0};
+
+    report.type = HID_TYPE_MOUSE_REPORT;
+
+    // Button changes go out at once. Motion waits for an empty buffer and is added up meanwhile, so at most one motion
+    // report is ever queued.
+    if (mouse_keys_buttons_changed() || hid_report_is_empty(HID_TYPE_MOUSE_REPORT)) {
+        if (mouse_keys_report_take(report.data.mouse)) {
+            hids_send_report(&report);
+        }
     }
 
-    bool is_empty_cc_report = cc_report.data.cc == 0;
+    mouse_timer_update();
+}
 
-    if (!empty_cc_report_sent || !is_empty_cc_report) {
-        empty_cc_report_sent = is_empty_cc_report;
+// Motion is added up once per connection interval while a move key is held or motion is left to report.
+static void mouse_timer_update(void) {
+    ret_code_t err_code;
+    bool active = mouse_keys_is_active() && m_conn_handle != BLE_CONN_HANDLE_INVALID;
 
-        NRF_LOG_INFO("generate_hid_report; cc len: %d", is_empty_cc_report ? 0 : 1);
+    if (active == m_mouse_timer_running) {
+        return;
+    }
 
-        hids_send_report(&cc_report);
+    if (active) {
+        err_code = app_timer_start(m_mouse_timer_id, MAX(m_mouse_interval_ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+        APP_ERROR_CHECK(err_code);
+    } else {
+        err_code = app_timer_stop(m_mouse_timer_id);
+        APP_ERROR_CHECK(err_code);
     }
+
+    m_mouse_timer_running = active;
+}
+
+static void mouse_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    ret_code_t err_code;
+
+    err_code = app_sched_event_put(NULL, 0, mouse_timeout_task);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void mouse_timeout_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    mouse_keys_tick(app_timer_cnt_get());
+    mouse_report_send();
+}
+
+static void conn_idle_init(void) {
+    conn_policy_init_t conn_policy_init_params = {0};
+
+    conn_policy_init_params.ms_get = uptime_ms_get;
+    conn_policy_init_params.params_request = conn_params_request;
+    conn_policy_init_params.timer_start = conn_idle_timer_start;
+
+    conn_policy_init(&conn_policy_init_params);
+}
+
+static conn_policy_params_t conn_policy_params_of(ble_gap_conn_params_t const *p_params) {
+    conn_policy_params_t params = {0};
+
+    params.min_conn_interval = p_params->min_conn_interval;
+    params.max_conn_interval = p_params->max_conn_interval;
+    params.slave_latency = p_params->slave_latency;
+    params.conn_sup_timeout = p_params->conn_sup_timeout;
+
+    return params;
+}
+
+// Goes through ble_conn_params, so it negotiates towards these parameters and not back to the ones given at init.
+static bool conn_params_request(conn_policy_params_t const *p_params) {
+    ret_code_t err_code;
+    ble_gap_conn_params_t params = {0};
+
+    params.min_conn_interval = p_params->min_conn_interval;
+    params.max_conn_interval = p_params->max_conn_interval;
+    params.slave_latency = p_params->slave_latency;
+    params.conn_sup_timeout = p_params->conn_sup_timeout;
+
+    err_code = ble_conn_params_change_conn_params(m_conn_handle, &params);
+
+    NRF_LOG_INFO("Conn params request; ret: 0x%X.", err_code);
+
+    return err_code == NRF_SUCCESS;
+}
+
+static void conn_idle_timer_start(uint32_t ms) {
+    ret_code_t err_code;
+
+    err_code = app_timer_start(m_conn_idle_timer_id, MAX(APP_TIMER_TICKS(ms), APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void conn_idle_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    ret_code_t err_code;
+
+    err_code = app_sched_event_put(NULL, 0, conn_idle_timeout_task);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void conn_idle_timeout_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    conn_policy_timeout();
 }
 
 #ifdef HAS_SLAVE
-static void process_slave_key_index(int8_t *p_key_index, uint16_t size) {
+static void update_slave_key_index(int8_t const *p_key_index, uint16_t size) {
+    key_set_t pressed;
+    key_set_t released;
+    key_set_t new_pressed;
+    key_event_t event = {0};
+
+    // Slave indexes come over the air, the set keeps them inside the key table.
+    key_set_from_list(&pressed, p_key_index, size);
+    key_set_diff(&m_slave_pressed, &pressed, &released, &new_pressed);
+
+    // Slave sends pressed keys, not transitions. Changes of one update share its arrival time, releases go first.
+    event.timestamp = app_timer_cnt_get();
+    event.pressed = false;
+
+    while ((event.key_index = key_set_pop(&released)) >= 0) {
+        combo_event_process(&event);
+    }
+
+    event.pressed = true;
+
+    while ((event.key_index = key_set_pop(&new_pressed)) >= 0) {
+        combo_event_process(&event);
+    }
+
+    m_slave_pressed = pressed;
+}
+
+static void process_slave_key_index(int8_t const *p_key_index, uint16_t size) {
     NRF_LOG_INFO("process_slave_key_index; len: %i.", size);
-    update_key_index(p_key_index, size, SOURCE_SLAVE);
-    translate_key_index();
+    CYCLE_STATS_BEGIN(update);
+    update_slave_key_index(p_key_index, size);
+    CYCLE_STATS_END(update, CYCLE_STATS_UPDATE);
+
+    key_events_done();
 }
 
 static void clear_slave_key_index(void) {
     NRF_LOG_INFO("clear_slave_key_index.");
-    int i = 0;
 
-    while (i < m_key_count) {
-        while (m_keys[i].source != SOURCE_SLAVE && i < m_key_count) {
-            i++;
-        }
+    update_slave_key_index(NULL, 0);
 
-        if (i < m_key_count) {
-            for (int j = i; j < m_key_count - 1; j++) {
-                m_keys[j] = m_keys[j + 1];
-            }
-
-            m_key_count--;
-        }
-    }
-
-    // Only remove keys, so no translation needed.
-    generate_hid_report();
+    key_events_done();
 }
 #endif
@@ -10,7 +10,6 @@
 #include "nordic_common.h"
 #include "nrf_assert.h"
 #include "nrf_ble_gatt.h"
-#include "nrf_delay.h"
 #include "nrf_gpio.h"
 #include "nrf_log.h"
 #include "nrf_sdh_ble.h"
@@ -19,10 +18,14 @@
 #include "nrf.h"
 
 #include "config/keyboard.h"
+#include "cycle_stats/cycle_stats.h"
 #include "error_handler/error_handler.h"
 #include "firmware_config.h"
+#include "key_event/key_event.h"
 #include "kb_link/kb_link.h"
 #include "low_power/low_power.h"
+#include "matrix/matrix.h"
+#include "matrix/matrix_strobe_nrf.h"
 #include "shared/shared.h"
 
 /*
@@ -42,12 +45,7 @@ const uint8_t ROWS[MATRIX_ROW_NUM] = MATRIX_ROW_PINS;
 const uint8_t COLS[MATRIX_COL_NUM] = MATRIX_COL_PINS;
 const int8_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM] = MATRIX_DEFINE;
 
-static bool m_key_pressed[MATRIX_ROW_NUM][MATRIX_COL_NUM] = {0};
-static int m_debounce[MATRIX_ROW_NUM][MATRIX_COL_NUM];
-static int m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-
-static int8_t m_active_key_index[SLAVE_KEY_NUM] = {0};
-static uint16_t m_active_key_index_count = 0;
+static key_event_active_t m_active_keys;
 
 /*
  * Functions declaration.
@@ -67,7 +65,11 @@ static void timers_start(void);
 
 // Firmware functions.
 static void firmware_init(void);
+static void scan_matrix_init(void);
+static void scan_start_task(void *p_data, uint16_t size);
+static void scan_pass_done_handler(void);
 static void scan_matrix_task(void *p_data, uint16_t size);
+static void matrix_evt_handler(matrix_evt_t const *p_evt);
 
 int main(void) {
     // Initialize.
@@ -90,6 +92,8 @@ int main(void) {
     // Firmware.
     firmware_init();
     pins_init();
+    scan_matrix_init();
+    uptime_start();
     low_power_mode_init(&m_scan_timer_id, scan_timeout_handler);
 
     // Start.
@@ -122,7 +126,7 @@ static void scan_timeout_handler(void *p_context) {
     UNUSED_PARAMETER(p_context);
     ret_code_t err_code;
 
-    err_code = app_sched_event_put(NULL, 0, scan_matrix_task);
+    err_code = app_sched_event_put(NULL, 0, scan_start_task);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -299,92 +303,67 @@ static void timers_start(void) {
 static void firmware_init(void) {
     NRF_LOG_INFO("firmware_init.");
 
-    for (int i = 0; i < MATRIX_ROW_NUM; i++) {
-        for (int j = 0; j < MATRIX_COL_NUM; j++) {
-            m_debounce[i][j] = KEY_PRESS_DEBOUNCE;
-        }
+    CYCLE_STATS_INIT();
+}
+
+static void scan_matrix_init(void) {
+    matrix_init_t init = {0};
+
+    init.p_backend = &MATRIX_STROBE_NRF_BACKEND;
+    init.pass_done_handler = scan_pass_done_handler;
+    init.evt_handler = matrix_evt_handler;
+    init.timestamp_get = app_timer_cnt_get;
+
+    key_event_active_init(&m_active_keys, SLAVE_KEY_NUM);
+    matrix_init(&init);
+}
+
+static void scan_start_task(void *p_data, uint16_t size) {
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(size);
+
+    // A tick queued before rows went to sense must not drive columns.
+    if (low_power_mode_is_active()) {
+        return;
     }
+
+    // If previous pass is still in progress, this tick is skipped.
+    matrix_scan_start();
+}
+
+static void scan_pass_done_handler(void) {
+    ret_code_t err_code;
+
+    // Called from settle timer interrupt, process the pass in main context.
+    err_code = app_sched_event_put(NULL, 0, scan_matrix_task);
+    APP_ERROR_CHECK(err_code);
 }
 
 static void scan_matrix_task(void *p_data, uint16_t size) {
     UNUSED_PARAMETER(p_data);
     UNUSED_PARAMETER(size);
 
-    ret_code_t err_code;
-    bool key_changed = false;
-
-    for (int col = 0; col < MATRIX_COL_NUM; col++) {
-        nrf_gpio_pin_set(COLS[col]);
-        nrf_delay_us(PIN_SET_DELAY);
-
-        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
-            bool pressed = nrf_gpio_pin_read(ROWS[row]) > 0;
-
-            if (m_key_pressed[row][col] == pressed) {
-                if (pressed) {
-                    m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-                } else {
-                    m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
-                }
-            } else {
-                if (m_debounce[row][col] <= 0) {
-                    if (pressed) {
-                        // On key press.
-                        m_key_pressed[row][col] = true;
-                        m_debounce[row][col] = KEY_RELEASE_DEBOUNCE;
-                        key_changed = true;
-
-                        if (m_active_key_index_count < SLAVE_KEY_NUM) {
-                            int i = 0;
-
-                            while (i < m_active_key_index_count && m_active_key_index[i] != MATRIX[row][col]) {
-                                i++;
-                            }
-
-                            if (i == m_active_key_index_count) {
-                                m_active_key_index[m_active_key_index_count++] = MATRIX[row][col];
-                            }
-                        }
-                    } else {
-                        // On key release.
-                        m_key_pressed[row][col] = false;
-                        m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
-                        key_changed = true;
-                        int i = 0;
-
-                        while (i < m_active_key_index_count && m_active_key_index[i] != MATRIX[row][col]) {
-                            i++;
-                        }
-
-                        if (i < m_active_key_index_count) {
-                            while (i < m_active_key_index_count) {
-                                m_active_key_index[i] = m_active_key_index[i + 1];
-                                i++;
-                            }
-
-                            m_active_key_index_count--;
-                        }
-                    }
-                } else {
-                    m_debounce[row][col] -= SCAN_DELAY;
-                }
-            }
-        }
+    CYCLE_STATS_BEGIN(scan);
 
-        nrf_gpio_pin_clear(COLS[col]);
-    }
+    bool key_changed = matrix_scan_step();
+
+    // Pick the next scan period, or wait on row sense until next press.
+    low_power_scan_update(key_changed || !matrix_is_settled(), matrix_is_idle());
 
-    if (key_changed) {
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
+    CYCLE_STATS_END(scan, CYCLE_STATS_SCAN);
+}
 
-        // Set active key index characteristics.
-        kb_link_active_key_index_update(&m_kb_link, (uint8_t *)m_active_key_index, m_active_key_index_count);
-    } else {
-        m_low_power_mode_counter -= SCAN_DELAY;
+static void matrix_evt_handler(matrix_evt_t const *p_evt) {
+    if (p_evt->type != MATRIX_EVT_KEYS_CHANGED) {
+        return;
     }
 
-    if (m_low_power_mode_counter <= 0) {
-        m_low_power_mode_counter = LOW_POWER_MODE_DELAY;
-        low_power_mode_start();
+    key_event_t event;
+
+    while (key_event_get(&event)) {
+        key_event_active_apply(&m_active_keys, &event);
     }
+
+    // Set active key index characteristics.
+    kb_link_active_key_index_update(&m_kb_link, (uint8_t *)m_active_keys.key_index, m_active_keys.count);
 }
@@ -0,0 +1,86 @@
+#include "matrix.h"
+
+#include <string.h>
+
+#include "../firmware_config.h"
+#include "../key_event/key_event.h"
+#include "matrix_debounce.h"
+#include "matrix_ghost.h"
+
+static matrix_evt_handler_t m_evt_handler;
+static uint32_t (*m_timestamp_get)(void);
+
+static uint32_t m_key_state[MATRIX_COL_NUM]; // Debounced row bitmap of each column.
+
+void matrix_init(matrix_init_t const *p_init) {
+    m_evt_handler = p_init->evt_handler;
+    m_timestamp_get = p_init->timestamp_get;
+
+    memset(m_key_state, 0, sizeof(m_key_state));
+
+    key_event_init();
+    matrix_debounce_init();
+
+    matrix_strobe_init_t init = {0};
+
+    init.p_backend = p_init->p_backend;
+    init.done_handler = p_init->pass_done_handler;
+
+    matrix_strobe_init(&init);
+}
+
+bool matrix_scan_start(void) {
+    return matrix_strobe_start();
+}
+
+bool matrix_scan_step(void) {
+    uint32_t const *p_rows = matrix_strobe_rows_get();
+    uint32_t changed[MATRIX_COL_NUM];
+
+#if MATRIX_GHOST_MODE == MATRIX_GHOST_BLOCK
+    uint32_t rows[MATRIX_COL_NUM];
+
+    memcpy(rows, p_rows, sizeof(rows));
+    matrix_ghost_block(rows, m_key_state);
+    p_rows = rows;
+#endif
+
+    if (!matrix_debounce(p_rows, m_key_state, changed)) {
+        return false;
+    }
+
+    key_event_t event = {0};
+
+    // Every transition of a pass gets the same time stamp.
+    event.timestamp = m_timestamp_get();
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        uint32_t col_changed = changed[col];
+
+        while (col_changed != 0) {
+            uint8_t row = __builtin_ctz(col_changed);
+
+            col_changed &= col_changed - 1;
+
+            event.key_index = MATRIX[row][col];
+            event.pressed = (m_key_state[col] & (1UL << row)) != 0;
+
+            key_event_put(&event);
+        }
+    }
+
+    matrix_evt_t evt = {0};
+
+    evt.type = MATRIX_EVT_KEYS_CHANGED;
+    m_evt_handler(&evt);
+
+    return true;
+}
+
+bool matrix_is_idle(void) {
+    return matrix_debounce_is_idle();
+}
+
+bool matrix_is_settled(void) {
+    return matrix_debounce_is_settled();
+}
@@ -0,0 +1,47 @@
+#ifndef _MATRIX_H_
+#define _MATRIX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../config/keyboard.h"
+#include "matrix_strobe.h"
+
+/*
+ * Matrix engine shared by master and slave.
+ * Runs strobe passes, debounces them and puts every key transition into the key event queue.
+ * Hardware is only reached through the strobe backend, so the engine also runs on a host with a fake backend.
+ */
+
+typedef enum {
+    MATRIX_EVT_KEYS_CHANGED // Once per pass with key changes, after its key events are queued.
+} matrix_evt_type_t;
+
+typedef struct {
+    matrix_evt_type_t type;
+} matrix_evt_t;
+
+typedef void (*matrix_evt_handler_t)(matrix_evt_t const *p_evt);
+
+typedef struct {
+    matrix_strobe_backend_t const *p_backend;
+    matrix_strobe_done_handler_t pass_done_handler; // Called from settle timer context, should get matrix_scan_step() run.
+    matrix_evt_handler_t evt_handler;
+    uint32_t (*timestamp_get)(void); // Time stamp of key events, RTC ticks on target.
+} matrix_init_t;
+
+void matrix_init(matrix_init_t const *p_init);
+
+// Start a strobe pass. Returns false if previous pass is still in progress.
+bool matrix_scan_start(void);
+
+// Debounce the last completed pass and send events. Returns true if any key changed.
+bool matrix_scan_step(void);
+
+// True if no key is pressed or debouncing.
+bool matrix_is_idle(void);
+
+// True if no key is debouncing, keys may be held.
+bool matrix_is_settled(void);
+
+#endif
@@ -0,0 +1,276 @@
+#include "matrix_debounce.h"
+
+#include <string.h>
+
+#include "../firmware_config.h"
+
+// Windows in number of scans. A deferred change is accepted on the first scan after the window has passed,
+// an eager change locks the key out for the eager window of scans after it. The deferred release window is long to sit out
+// bounce before a release is believed, a lockout that long would hold back the next press of the key.
+#define PRESS_DEBOUNCE_SCANS   (KEY_PRESS_DEBOUNCE / SCAN_DELAY)
+#define RELEASE_DEBOUNCE_SCANS (KEY_RELEASE_DEBOUNCE / SCAN_DELAY)
+#define EAGER_DEBOUNCE_SCANS   (KEY_EAGER_DEBOUNCE / SCAN_DELAY)
+#define MAX_DEFER_SCANS        (PRESS_DEBOUNCE_SCANS > RELEASE_DEBOUNCE_SCANS ? PRESS_DEBOUNCE_SCANS : RELEASE_DEBOUNCE_SCANS)
+#define MAX_DEBOUNCE_SCANS     (MAX_DEFER_SCANS > EAGER_DEBOUNCE_SCANS ? MAX_DEFER_SCANS : EAGER_DEBOUNCE_SCANS)
+
+#if PRESS_DEBOUNCE_SCANS < 1 || RELEASE_DEBOUNCE_SCANS < 1 || EAGER_DEBOUNCE_SCANS < 1
+#error "Debounce window is shorter than SCAN_DELAY."
+#endif
+
+#if MAX_DEBOUNCE_SCANS >= 64
+#error "Debounce window is too long for SCAN_DELAY."
+#endif
+
+static bool m_idle = true;
+static bool m_settled = true;
+
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PER_KEY || DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PER_KEY || DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PRESS_DEFER_RELEASE
+
+// Counter bits needed to count up to MAX_DEBOUNCE_SCANS.
+#define COUNTER_BITS (MAX_DEBOUNCE_SCANS < 2 ? 1 : MAX_DEBOUNCE_SCANS < 4 ? 2 : MAX_DEBOUNCE_SCANS < 8 ? 3 : MAX_DEBOUNCE_SCANS < 16 ? 4 : MAX_DEBOUNCE_SCANS < 32 ? 5 : 6)
+
+// Vertical counters, bit n of every plane together is the counter of row n. Indexed by [plane][column].
+static uint32_t m_counters[COUNTER_BITS][MATRIX_COL_NUM];
+
+// Mask of keys whose counter equals scans. scans is a constant, so this folds into one AND per plane.
+static inline uint32_t counter_equals(uint8_t col, uint32_t scans) {
+    uint32_t equals = UINT32_MAX;
+
+    for (int i = 0; i < COUNTER_BITS; i++) {
+        equals &= (scans & (1UL << i)) ? m_counters[i][col] : ~m_counters[i][col];
+    }
+
+    return equals;
+}
+
+// Mask of keys whose counter is running.
+static inline uint32_t counter_nonzero(uint8_t col) {
+    uint32_t nonzero = 0;
+
+    for (int i = 0; i < COUNTER_BITS; i++) {
+        nonzero |= m_counters[i][col];
+    }
+
+    return nonzero;
+}
+
+// Add one to the counters of keys in mask, ripple carry through the planes.
+static inline void counter_increment(uint8_t col, uint32_t mask) {
+    uint32_t carry = mask;
+
+    for (int i = 0; i < COUNTER_BITS; i++) {
+        uint32_t next_carry = m_counters[i][col] & carry;
+
+        m_counters[i][col] ^= carry;
+        carry = next_carry;
+    }
+}
+
+static inline void counter_clear(uint8_t col, uint32_t mask) {
+    for (int i = 0; i < COUNTER_BITS; i++) {
+        m_counters[i][col] &= ~mask;
+    }
+}
+
+#else
+
+// One counter for every key of a column.
+static uint8_t m_column_scans[MATRIX_COL_NUM];
+
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PER_COLUMN
+static uint32_t m_last_raw[MATRIX_COL_NUM];
+#endif
+
+#endif
+
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PER_KEY
+
+// Returns keys of the column that change state.
+static uint32_t debounce_column(uint8_t col, uint32_t raw, uint32_t state) {
+    uint32_t diff = raw ^ state;
+
+    if (diff == 0) {
+        // Nothing is bouncing in this column, skip counter arithmetic.
+        counter_clear(col, UINT32_MAX);
+        return 0;
+    }
+
+    // Keys matching their state restart counting.
+    counter_clear(col, ~diff);
+
+    // Pressed keys wait for the release window, released keys for the press window.
+    uint32_t done = diff & ((state & counter_equals(col, RELEASE_DEBOUNCE_SCANS)) | (~state & counter_equals(col, PRESS_DEBOUNCE_SCANS)));
+
+    counter_increment(col, diff & ~done);
+    counter_clear(col, done);
+
+    return done;
+}
+
+// Keys ignoring bounce after a change, deferred algorithms have none.
+static inline uint32_t column_locked(uint8_t col) {
+    (void)col;
+
+    return 0;
+}
+
+#elif DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PER_KEY
+
+static uint32_t debounce_column(uint8_t col, uint32_t raw, uint32_t state) {
+    uint32_t diff = raw ^ state;
+    uint32_t locked = counter_nonzero(col);
+
+    if ((diff | locked) == 0) {
+        return 0;
+    }
+
+    // Keys that are not locked out change at once and start their lockout.
+    uint32_t done = diff & ~locked;
+
+    // Lockout ends after the scan the counter has reached the eager window on, the key ignores that many scans.
+    uint32_t expired = counter_equals(col, EAGER_DEBOUNCE_SCANS);
+
+    counter_increment(col, (locked & ~expired) | done);
+    counter_clear(col, expired);
+
+    return done;
+}
+
+static inline uint32_t column_locked(uint8_t col) {
+    return counter_nonzero(col);
+}
+
+#elif DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PRESS_DEFER_RELEASE
+
+static uint32_t debounce_column(uint8_t col, uint32_t raw, uint32_t state) {
+    uint32_t diff = raw ^ state;
+
+    if (diff == 0) {
+        counter_clear(col, UINT32_MAX);
+        return 0;
+    }
+
+    counter_clear(col, ~diff);
+
+    // Presses are taken at once, releases wait for the release window.
+    uint32_t done = (diff & ~state) | (diff & state & counter_equals(col, RELEASE_DEBOUNCE_SCANS));
+
+    counter_increment(col, diff & ~done);
+    counter_clear(col, done);
+
+    return done;
+}
+
+static inline uint32_t column_locked(uint8_t col) {
+    (void)col;
+
+    return 0;
+}
+
+#elif DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PER_COLUMN
+
+static uint32_t debounce_column(uint8_t col, uint32_t raw, uint32_t state) {
+    uint32_t diff = raw ^ state;
+
+    // Any change in the column restarts counting.
+    if (raw != m_last_raw[col] || diff == 0) {
+        m_last_raw[col] = raw;
+        m_column_scans[col] = 0;
+
+        if (diff == 0) {
+            return 0;
+        }
+    }
+
+    // The press window applies as soon as a key of the column is pressed.
+    uint8_t window = (diff & ~state) ? PRESS_DEBOUNCE_SCANS : RELEASE_DEBOUNCE_SCANS;
+
+    if (m_column_scans[col] < window) {
+        m_column_scans[col]++;
+        return 0;
+    }
+
+    m_column_scans[col] = 0;
+
+    return diff;
+}
+
+static inline uint32_t column_locked(uint8_t col) {
+    (void)col;
+
+    return 0;
+}
+
+#elif DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PER_COLUMN
+
+static uint32_t debounce_column(uint8_t col, uint32_t raw, uint32_t state) {
+    uint32_t diff = raw ^ state;
+
+    if (m_column_scans[col] > 0) {
+        m_column_scans[col]--;
+        return 0;
+    }
+
+    if (diff == 0) {
+        return 0;
+    }
+
+    // Lock the column out for the eager window.
+    m_column_scans[col] = EAGER_DEBOUNCE_SCANS;
+
+    return diff;
+}
+
+static inline uint32_t column_locked(uint8_t col) {
+    return m_column_scans[col] ? UINT32_MAX : 0;
+}
+
+#else
+#error "Unknown DEBOUNCE_ALGORITHM."
+#endif
+
+void matrix_debounce_init(void) {
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PER_KEY || DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PER_KEY || DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PRESS_DEFER_RELEASE
+    memset(m_counters, 0, sizeof(m_counters));
+#else
+    memset(m_column_scans, 0, sizeof(m_column_scans));
+#endif
+
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PER_COLUMN
+    memset(m_last_raw, 0, sizeof(m_last_raw));
+#endif
+
+    m_idle = true;
+    m_settled = true;
+}
+
+bool matrix_debounce(uint32_t const *p_raw, uint32_t *p_state, uint32_t *p_changed) {
+    uint32_t any_changed = 0;
+    uint32_t any_pending = 0;
+    uint32_t any_pressed = 0;
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        uint32_t done = debounce_column(col, p_raw[col], p_state[col]);
+
+        p_state[col] ^= done;
+        p_changed[col] = done;
+        any_changed |= done;
+
+        // A key is pending while its reading differs from its state or it is locked out.
+        any_pending |= (p_state[col] ^ p_raw[col]) | column_locked(col);
+        any_pressed |= p_state[col];
+    }
+
+    m_settled = any_pending == 0;
+    m_idle = m_settled && any_pressed == 0;
+
+    return any_changed != 0;
+}
+
+bool matrix_debounce_is_idle(void) {
+    return m_idle;
+}
+
+bool matrix_debounce_is_settled(void) {
+    return m_settled;
+}
@@ -0,0 +1,27 @@
+#ifndef _MATRIX_DEBOUNCE_H_
+#define _MATRIX_DEBOUNCE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../config/keyboard.h"
+
+/*
+ * Bit-parallel debounce.
+ * Matrix state is packed as one row bitmap per column. Every key of a bitmap is debounced at once
+ * with vertical counters, one counter bit-plane per word, or with one counter per column.
+ * The algorithm is selected by DEBOUNCE_ALGORITHM in firmware_config.h.
+ */
+
+void matrix_debounce_init(void);
+
+// Debounce one raw pass into p_state, keys that changed state are set in p_changed. Returns true if any key changed.
+bool matrix_debounce(uint32_t const *p_raw, uint32_t *p_state, uint32_t *p_changed);
+
+// True if the last pass had no key pressed and no key debouncing.
+bool matrix_debounce_is_idle(void);
+
+// True if the last pass had no key debouncing, keys may be held.
+bool matrix_debounce_is_settled(void);
+
+#endif
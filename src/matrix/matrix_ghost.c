@@ -0,0 +1,26 @@
+#include "matrix_ghost.h"
+
+void matrix_ghost_block(uint32_t *p_raw, uint32_t const *p_state) {
+    uint32_t ambiguous[MATRIX_COL_NUM] = {0};
+
+    for (int i = 0; i < MATRIX_COL_NUM - 1; i++) {
+        // A column with less than two rows read can not be part of a rectangle.
+        if ((p_raw[i] & (p_raw[i] - 1)) == 0) {
+            continue;
+        }
+
+        for (int j = i + 1; j < MATRIX_COL_NUM; j++) {
+            uint32_t common = p_raw[i] & p_raw[j];
+
+            // Two or more shared rows.
+            if ((common & (common - 1)) != 0) {
+                ambiguous[i] |= common;
+                ambiguous[j] |= common;
+            }
+        }
+    }
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        p_raw[col] &= ~ambiguous[col] | p_state[col];
+    }
+}
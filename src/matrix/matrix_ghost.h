@@ -0,0 +1,17 @@
+#ifndef _MATRIX_GHOST_H_
+#define _MATRIX_GHOST_H_
+
+#include <stdint.h>
+
+#include "../config/keyboard.h"
+
+/*
+ * Ghost blocking for matrices without a diode on every key.
+ * Without diodes, three pressed corners of a rectangle make the fourth read pressed. Two columns sharing two
+ * or more read rows form such a rectangle, so every key on it is ambiguous.
+ */
+
+// Clear from p_raw the ambiguous keys that are not pressed in p_state, keys already pressed stay.
+void matrix_ghost_block(uint32_t *p_raw, uint32_t const *p_state);
+
+#endif
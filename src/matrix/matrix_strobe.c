@@ -0,0 +1,70 @@
+#include "matrix_strobe.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static matrix_strobe_backend_t const *m_p_backend;
+static matrix_strobe_done_handler_t m_done_handler;
+
+static volatile bool m_busy = false;
+static uint8_t m_col = 0;
+static uint32_t m_sampling_rows[MATRIX_COL_NUM]; // Rows of the pass in progress.
+static uint32_t m_rows[MATRIX_COL_NUM];          // Rows of the last completed pass, indexed by column.
+
+void matrix_strobe_init(matrix_strobe_init_t const *p_init) {
+    m_p_backend = p_init->p_backend;
+    m_done_handler = p_init->done_handler;
+
+    memset(m_sampling_rows, 0, sizeof(m_sampling_rows));
+    memset(m_rows, 0, sizeof(m_rows));
+
+    if (m_p_backend->init != NULL) {
+        m_p_backend->init();
+    }
+}
+
+bool matrix_strobe_start(void) {
+    if (m_busy) {
+        return false;
+    }
+
+    // State must be in place before the settle timer is armed.
+    m_busy = true;
+    m_col = 0;
+
+    m_p_backend->col_set(m_col);
+    m_p_backend->settle_start();
+
+    return true;
+}
+
+void matrix_strobe_settled(void) {
+    if (!m_busy) {
+        return;
+    }
+
+    m_sampling_rows[m_col] = m_p_backend->rows_read();
+    m_p_backend->col_clear(m_col);
+
+    if (++m_col < MATRIX_COL_NUM) {
+        m_p_backend->col_set(m_col);
+        m_p_backend->settle_start();
+        return;
+    }
+
+    // Pass complete, publish it.
+    memcpy(m_rows, m_sampling_rows, sizeof(m_rows));
+    m_busy = false;
+
+    if (m_done_handler != NULL) {
+        m_done_handler();
+    }
+}
+
+bool matrix_strobe_is_busy(void) {
+    return m_busy;
+}
+
+uint32_t const *matrix_strobe_rows_get(void) {
+    return m_rows;
+}
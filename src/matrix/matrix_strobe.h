@@ -0,0 +1,38 @@
+#ifndef _MATRIX_STROBE_H_
+#define _MATRIX_STROBE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../config/keyboard.h"
+
+/*
+ * Column strobe engine.
+ * One column is driven at a time, the engine then returns and samples the rows when the backend
+ * reports that the column has settled, so a matrix pass never busy-waits.
+ */
+
+// Hardware access of the strobe engine. Swap it for a fake GPIO/timer backend to run the engine on a host.
+typedef struct {
+    void (*init)(void);
+    void (*col_set)(uint8_t col);
+    void (*col_clear)(uint8_t col);
+    uint32_t (*rows_read)(void); // Row bitmap, bit n is set when row n reads high.
+    void (*settle_start)(void);  // Arm settle timer, matrix_strobe_settled() must be called when it expires.
+} matrix_strobe_backend_t;
+
+// Called from settle timer context once every column of a pass is sampled.
+typedef void (*matrix_strobe_done_handler_t)(void);
+
+typedef struct {
+    matrix_strobe_backend_t const *p_backend;
+    matrix_strobe_done_handler_t done_handler;
+} matrix_strobe_init_t;
+
+void matrix_strobe_init(matrix_strobe_init_t const *p_init);
+bool matrix_strobe_start(void);
+void matrix_strobe_settled(void);
+bool matrix_strobe_is_busy(void);
+uint32_t const *matrix_strobe_rows_get(void);
+
+#endif
@@ -0,0 +1,80 @@
+#include "matrix_strobe_nrf.h"
+
+#include "app_error.h"
+#include "nrf.h"
+#include "nrfx_timer.h"
+
+#include "../config/keyboard.h"
+#include "../firmware_config.h"
+
+// Pin of each matrix line must fit in the P0 register.
+#define PIN_ON_P0(pin) && ((pin) < 32)
+STATIC_ASSERT(1 MACRO_MAP(PIN_ON_P0, MATRIX_ROW_PIN_LIST) MACRO_MAP(PIN_ON_P0, MATRIX_COL_PIN_LIST));
+STATIC_ASSERT(MATRIX_ROW_NUM <= 32);
+
+// OUTSET/OUTCLR mask of each column.
+#define COL_MASK(pin) (1UL << (pin)),
+static const uint32_t COL_MASKS[MATRIX_COL_NUM] = {MACRO_MAP(COL_MASK, MATRIX_COL_PIN_LIST)};
+
+// Moves the IN bit of a row pin to its row position. Shifts are constants, so a row costs a bitfield extract and an OR.
+#define ROW_BIT(pin, row) | (((in >> (pin)) & 1UL) << (row))
+
+static const nrfx_timer_t m_settle_timer = NRFX_TIMER_INSTANCE(MATRIX_STROBE_TIMER_INSTANCE);
+
+static void backend_init(void);
+static void col_set(uint8_t col);
+static void col_clear(uint8_t col);
+static uint32_t rows_read(void);
+static void settle_start(void);
+static void settle_timer_evt_handler(nrf_timer_event_t event_type, void *p_context);
+
+const matrix_strobe_backend_t MATRIX_STROBE_NRF_BACKEND = {
+    .init = backend_init,
+    .col_set = col_set,
+    .col_clear = col_clear,
+    .rows_read = rows_read,
+    .settle_start = settle_start
+};
+
+static void backend_init(void) {
+    ret_code_t err_code;
+    nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG;
+
+    config.frequency = NRF_TIMER_FREQ_1MHz;
+    config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+    err_code = nrfx_timer_init(&m_settle_timer, &config, settle_timer_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    // Timer stops itself on compare, so HFCLK is only requested while a column is settling.
+    nrfx_timer_extended_compare(&m_settle_timer, NRF_TIMER_CC_CHANNEL0, nrfx_timer_us_to_ticks(&m_settle_timer, PIN_SET_DELAY), NRF_TIMER_SHORT_COMPARE0_STOP_MASK, true);
+}
+
+static void col_set(uint8_t col) {
+    NRF_P0->OUTSET = COL_MASKS[col];
+}
+
+static void col_clear(uint8_t col) {
+    NRF_P0->OUTCLR = COL_MASKS[col];
+}
+
+static uint32_t rows_read(void) {
+    // One read of the whole port, then every row is picked out of it.
+    uint32_t in = NRF_P0->IN & MATRIX_ROW_PORT_MASK;
+
+    return 0 MACRO_MAP_FOR(ROW_BIT, MATRIX_ROW_PIN_LIST);
+}
+
+static void settle_start(void) {
+    nrfx_timer_clear(&m_settle_timer);
+    nrfx_timer_enable(&m_settle_timer);
+}
+
+static void settle_timer_evt_handler(nrf_timer_event_t event_type, void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    if (event_type == NRF_TIMER_EVENT_COMPARE0) {
+        nrfx_timer_disable(&m_settle_timer);
+        matrix_strobe_settled();
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef _MATRIX_STROBE_NRF_H_
+#define _MATRIX_STROBE_NRF_H_
+
+#include "app_util.h"
+
+#include "../config/keyboard.h"
+#include "matrix_strobe.h"
+
+// Port masks of the matrix pins, computed at compile time from pin lists in keyboard.h. All pins are on P0.
+#define MATRIX_PIN_MASK(pin) | (1UL << (pin))
+#define MATRIX_ROW_PORT_MASK (0 MACRO_MAP(MATRIX_PIN_MASK, MATRIX_ROW_PIN_LIST))
+#define MATRIX_COL_PORT_MASK (0 MACRO_MAP(MATRIX_PIN_MASK, MATRIX_COL_PIN_LIST))
+
+// Strobe backend on nRF52 GPIO, column settle time is measured by a TIMER instance.
+extern const matrix_strobe_backend_t MATRIX_STROBE_NRF_BACKEND;
+
+#endif
@@ -0,0 +1,157 @@
+#include "mouse_keys.h"
+
+#include "../firmware_config.h"
+#include "../keycodes.h"
+#include "../port/port.h"
+
+#define TICKS_MASK 0x00FFFFFF // RTC counter is 24 bits.
+#define CURVE_ONE  256        // Fixed point one of the acceleration curve.
+
+STATIC_ASSERT(MOUSE_KEYS_TIME_TO_MAX > 0);
+
+// Held keys, one bit per MOUSE_CODE.
+#define HELD(code) (1U << MOUSE_CODE(code))
+#define MOVE_KEYS  (HELD(KC_MS_UP) | HELD(KC_MS_DOWN) | HELD(KC_MS_LEFT) | HELD(KC_MS_RIGHT) | \
+                    HELD(KC_MS_WH_UP) | HELD(KC_MS_WH_DOWN))
+
+static int32_t m_count; // One count of motion, motion is kept in counts per second times ticks.
+static uint32_t m_time_to_max_ticks;
+
+static uint16_t m_held;
+static uint8_t m_buttons;
+static uint8_t m_buttons_taken;
+
+static uint32_t m_last_tick;
+static uint32_t m_move_ticks; // Time move keys have been held, up to m_time_to_max_ticks.
+
+// Motion not reported yet, in m_count units.
+static int32_t m_x;
+static int32_t m_y;
+static int32_t m_wheel;
+
+static int direction(uint32_t positive, uint32_t negative) {
+    return ((m_held & HELD(positive)) ? 1 : 0) - ((m_held & HELD(negative)) ? 1 : 0);
+}
+
+static uint32_t speed_get(void) {
+    uint32_t ratio = m_move_ticks * CURVE_ONE / m_time_to_max_ticks;
+    uint32_t curve = CURVE_ONE;
+
+    for (int i = 0; i < MOUSE_KEYS_CURVE; i++) {
+        curve = curve * ratio / CURVE_ONE;
+    }
+
+    return MOUSE_KEYS_SPEED_MIN + (MOUSE_KEYS_SPEED_MAX - MOUSE_KEYS_SPEED_MIN) * curve / CURVE_ONE;
+}
+
+// Whole counts of motion, at most one report worth. The rest stays for the next report.
+static int8_t counts_take(int32_t *p_motion) {
+    int32_t counts = *p_motion / m_count;
+
+    counts = MAX(MIN(counts, 127), -127);
+    *p_motion -= counts * m_count;
+
+    return counts;
+}
+
+void mouse_keys_init(mouse_keys_init_t const *p_init) {
+    m_count = p_init->ticks_get(1000);
+    m_time_to_max_ticks = p_init->ticks_get(MOUSE_KEYS_TIME_TO_MAX);
+
+    m_held = 0;
+    m_buttons = 0;
+    m_buttons_taken = 0;
+
+    m_last_tick = 0;
+    m_move_ticks = 0;
+
+    m_x = 0;
+    m_y = 0;
+    m_wheel = 0;
+}
+
+void mouse_keys_key(uint32_t code, bool pressed, uint32_t now) {
+    if (KC_MS_BTN1 <= code && code <= KC_MS_BTN5) {
+        uint8_t button = 1U << (code - KC_MS_BTN1);
+
+        if (pressed) {
+            m_buttons |= button;
+        } else {
+            m_buttons &= ~button;
+        }
+
+        return;
+    }
+
+    // Motion so far goes with the keys held until now.
+    mouse_keys_tick(now);
+
+    if (!pressed) {
+        m_held &= ~HELD(code);
+        return;
+    }
+
+    if ((m_held & MOVE_KEYS) == 0) {
+        m_last_tick = now;
+        m_move_ticks = 0;
+    }
+
+    m_held |= HELD(code);
+
+    // A press moves one count at once, a tap moves the pointer by one.
+    if (code == KC_MS_RIGHT || code == KC_MS_LEFT) {
+        m_x += direction(KC_MS_RIGHT, KC_MS_LEFT) * m_count;
+    } else if (code == KC_MS_DOWN || code == KC_MS_UP) {
+        m_y += direction(KC_MS_DOWN, KC_MS_UP) * m_count;
+    } else {
+        m_wheel += direction(KC_MS_WH_UP, KC_MS_WH_DOWN) * m_count;
+    }
+}
+
+void mouse_keys_tick(uint32_t now) {
+    uint32_t ticks = (now - m_last_tick) & TICKS_MASK;
+
+    m_last_tick = now;
+
+    if ((m_held & MOVE_KEYS) == 0) {
+        return;
+    }
+
+    m_move_ticks = MIN(m_move_ticks + ticks, m_time_to_max_ticks);
+
+    int32_t distance = speed_get() * ticks;
+    int32_t wheel_distance = MOUSE_KEYS_WHEEL_SPEED * ticks;
+
+    m_x += direction(KC_MS_RIGHT, KC_MS_LEFT) * distance;
+    m_y += direction(KC_MS_DOWN, KC_MS_UP) * distance;
+    m_wheel += direction(KC_MS_WH_UP, KC_MS_WH_DOWN) * wheel_distance;
+}
+
+bool mouse_keys_buttons_changed(void) {
+    return m_buttons != m_buttons_taken;
+}
+
+bool mouse_keys_is_active(void) {
+    bool motion_left = m_x / m_count != 0 || m_y / m_count != 0 || m_wheel / m_count != 0;
+
+    return (m_held & MOVE_KEYS) != 0 || motion_left;
+}
+
+bool mouse_keys_report_take(uint8_t *p_report) {
+    int8_t x = counts_take(&m_x);
+    int8_t y = counts_take(&m_y);
+    int8_t wheel = counts_take(&m_wheel);
+
+    if (x == 0 && y == 0 && wheel == 0 && m_buttons == m_buttons_taken) {
+        return false;
+    }
+
+    m_buttons_taken = m_buttons;
+
+    p_report[0] = m_buttons;
+    p_report[1] = x;
+    p_report[2] = y;
+    p_report[3] = wheel;
+
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef _MOUSE_KEYS_H_
+#define _MOUSE_KEYS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Mouse keys.
+ * Move keys speed up along the MOUSE_KEYS_CURVE from MOUSE_KEYS_SPEED_MIN to MOUSE_KEYS_SPEED_MAX. Motion is added
+ * up on every tick and taken as one report, so motion made while no report can be sent goes out in the next one.
+ *
+ * Time only comes from the now of calls and the ticks_get conversion given at init, so a host build can drive it
+ * with any clock.
+ */
+
+#define MOUSE_REPORT_LEN 4 // Buttons, X, Y and wheel.
+
+typedef struct {
+    uint32_t (*ticks_get)(uint32_t ms); // Ticks of the now clock in ms, RTC ticks on target.
+} mouse_keys_init_t;
+
+void mouse_keys_init(mouse_keys_init_t const *p_init);
+
+// Apply a mouse keycode on press or release at now, in RTC ticks.
+void mouse_keys_key(uint32_t code, bool pressed, uint32_t now);
+
+// Add the motion of held keys up to now.
+void mouse_keys_tick(uint32_t now);
+
+// Buttons differ from the last report taken.
+bool mouse_keys_buttons_changed(void);
+
+// A move key is held or motion is left to report.
+bool mouse_keys_is_active(void);
+
+// Writes a report of the buttons and motion so far, motion beyond one report is left for the next. Returns false if
+// there is no motion and the buttons did not change.
+bool mouse_keys_report_take(uint8_t *p_report);
+
+#endif
@@ -0,0 +1,156 @@
+#include "pending_report.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../kb_report_queue/kb_report_queue.h"
+
+#define MODIFIER_BYTE (0xE0 / 8) // Byte of the state holding modifiers, same bit order as in reports.
+#define KEY_SLOT      2          // First key byte of a 6 key report.
+
+typedef struct {
+    uint32_t ms;  // Uptime the report was made at.
+    bool expires; // Made while the link was down.
+    hid_report_t report;
+} pending_report_t;
+
+static pending_report_t m_reports[PENDING_REPORT_NUM];
+static uint8_t m_start = 0;
+static uint8_t m_count = 0;
+
+static pending_report_t *entry_get(uint8_t index) {
+    return &m_reports[(m_start + index) % PENDING_REPORT_NUM];
+}
+
+static void state_from_report(hid_report_t const *p_report, uint8_t *p_state) {
+    memset(p_state, 0, KB_STATE_LEN);
+
+    if (p_report->type == HID_TYPE_NKRO_REPORT) {
+        memcpy(p_state, &p_report->data.nkro[1], NKRO_BITMAP_LEN);
+    } else {
+        for (int i = KEY_SLOT; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+            if (p_report->data.kb[i] != 0) {
+                p_state[p_report->data.kb[i] / 8] |= 1U << (p_report->data.kb[i] % 8);
+            }
+        }
+    }
+
+    p_state[MODIFIER_BYTE] = p_report->data.kb[0];
+}
+
+// Returns true if the newest pending report can be replaced by p_report with the host still seeing every key press,
+// each with the modifiers it had. The newest report and p_report must not both press keys, and p_report must not
+// take back a press of the newest one or press again a key the newest one released.
+static bool fold_is_safe(hid_report_t const *p_report, bool expires) {
+    if (m_count < 2 || p_report->type >= HID_KB_TYPE_NUM) {
+        return false;
+    }
+
+    pending_report_t const *p_newest = entry_get(m_count - 1);
+
+    if (p_newest->report.type != p_report->type || p_newest->expires != expires) {
+        return false;
+    }
+
+    // The report before the newest one of the same type, the host has its keys when the newest one comes.
+    int prev_index = m_count - 2;
+
+    while (prev_index >= 0 && entry_get(prev_index)->report.type != p_report->type) {
+        prev_index--;
+    }
+
+    if (prev_index < 0) {
+        return false;
+    }
+
+    uint8_t prev[KB_STATE_LEN];
+    uint8_t newest[KB_STATE_LEN];
+    uint8_t next[KB_STATE_LEN];
+    bool newest_presses = false;
+    bool next_presses = false;
+
+    state_from_report(&entry_get(prev_index)->report, prev);
+    state_from_report(&p_newest->report, newest);
+    state_from_report(p_report, next);
+
+    for (int i = 0; i < KB_STATE_LEN; i++) {
+        newest_presses |= (newest[i] & ~prev[i]) != 0;
+        next_presses |= (next[i] & ~newest[i]) != 0;
+    }
+
+    if (newest_presses && next_presses) {
+        return false;
+    }
+
+    for (int i = 0; i < KB_STATE_LEN; i++) {
+        if (newest_presses ? (newest[i] & ~prev[i] & ~next[i]) != 0 : (next[i] & prev[i] & ~newest[i]) != 0) {
+            return false;
+        }
+    }
+
+    // Presses of the newest report keep their modifiers.
+    return !newest_presses || newest[MODIFIER_BYTE] == next[MODIFIER_BYTE];
+}
+
+static void entry_put(hid_report_t const *p_report, uint32_t now, bool expires, bool fold) {
+    if (!fold) {
+        m_count++;
+    }
+
+    pending_report_t *p_pending = entry_get(m_count - 1);
+
+    p_pending->ms = now;
+    p_pending->expires = expires;
+    memcpy(&p_pending->report, p_report, sizeof(hid_report_t));
+}
+
+void pending_report_init(void) {
+    m_start = 0;
+    m_count = 0;
+}
+
+void pending_report_put(hid_report_t const *p_report, uint32_t now) {
+    pending_report_expire(now);
+
+    bool fold = fold_is_safe(p_report, true);
+
+    if (!fold && m_count == PENDING_REPORT_NUM) {
+        pending_report_pop();
+    }
+
+    entry_put(p_report, now, true, fold);
+}
+
+void pending_report_hold(hid_report_t const *p_report) {
+    bool fold = fold_is_safe(p_report, false);
+
+    if (!fold && m_count == PENDING_REPORT_NUM) {
+        if (entry_get(m_count - 1)->report.type == p_report->type) {
+            // Full, the newest report takes the keys as they stand. Its press may be lost, no key stays down.
+            fold = true;
+        } else {
+            pending_report_pop();
+        }
+    }
+
+    entry_put(p_report, 0, false, fold);
+}
+
+void pending_report_expire(uint32_t now) {
+    while (m_count > 0 && m_reports[m_start].expires && now - m_reports[m_start].ms > PENDING_REPORT_MAX_AGE) {
+        pending_report_pop();
+    }
+}
+
+hid_report_t const *pending_report_peek(void) {
+    return m_count > 0 ? &m_reports[m_start].report : NULL;
+}
+
+void pending_report_pop(void) {
+    m_start = (m_start + 1) % PENDING_REPORT_NUM;
+    m_count--;
+}
+
+uint8_t pending_report_count(void) {
+    return m_count;
+}
@@ -0,0 +1,38 @@
+#ifndef _PENDING_REPORT_H_
+#define _PENDING_REPORT_H_
+
+#include <stdint.h>
+
+#include "../hid_report/hid_report.h"
+
+/*
+ * Pending reports.
+ * Reports made while the host cannot take them, oldest first. Each holds every key down, so any of them can be left
+ * out without a key staying down on the host. Times are uptime ms, which keeps counting while rows wait on sense.
+ *
+ * A keyboard report replaces the newest pending one of its type when the host still sees every key press that way,
+ * with the modifiers it had: releases and modifier changes ride along with the press before or after them.
+ */
+
+void pending_report_init(void);
+
+// Report made while the link is down. Drops reports made while the link was down older than PENDING_REPORT_MAX_AGE
+// first, then the oldest one if still full.
+void pending_report_put(hid_report_t const *p_report, uint32_t now);
+
+// Report the host has no room for while the link is up, it never expires. When full, a report replaces the newest
+// one of its type rather than drop the oldest, only one of another type drops the oldest.
+void pending_report_hold(hid_report_t const *p_report);
+
+// Drops reports made while the link was down older than PENDING_REPORT_MAX_AGE, up to the first one made while it was
+// up.
+void pending_report_expire(uint32_t now);
+
+// Oldest report, NULL if there is none.
+hid_report_t const *pending_report_peek(void);
+
+void pending_report_pop(void);
+
+uint8_t pending_report_count(void);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef _PORT_H_
+#define _PORT_H_
+
+/*
+ * Target primitives used by the modules that also build on a host.
+ * Host programs in tools/ define HOST_BUILD, the firmware gets them from the SDK.
+ */
+
+#ifdef HOST_BUILD
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define PORT_MEMORY_BARRIER() __sync_synchronize()
+
+#define PORT_CRITICAL_REGION_ENTER() {
+#define PORT_CRITICAL_REGION_EXIT()  }
+
+#define STATIC_ASSERT(EXPR) _Static_assert(EXPR, #EXPR)
+
+#define MIN(A, B) ((A) < (B) ? (A) : (B))
+#define MAX(A, B) ((A) > (B) ? (A) : (B))
+
+// Time units of BLE parameters, as in app_util.h.
+enum {
+    UNIT_0_625_MS = 625,
+    UNIT_1_25_MS  = 1250,
+    UNIT_10_MS    = 10000
+};
+
+#define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
+
+#define PORT_CLZ(X) ((uint32_t)__builtin_clz(X)) // Undefined for 0, as on target.
+
+#define PORT_LOG_INFO(...)    (printf(__VA_ARGS__), printf("\n"))
+#define PORT_LOG_WARNING(...) (printf(__VA_ARGS__), printf("\n"))
+
+// Host cycle counter counts ns.
+#define PORT_CYCLE_COUNTER_START()
+
+static inline uint32_t port_cycle_counter_get(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+#else
+
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf.h"
+#include "nrf_log.h"
+
+#define PORT_MEMORY_BARRIER() __DMB()
+
+#define PORT_CRITICAL_REGION_ENTER() CRITICAL_REGION_ENTER()
+#define PORT_CRITICAL_REGION_EXIT()  CRITICAL_REGION_EXIT()
+
+#define PORT_CLZ(X) __CLZ(X)
+
+#define PORT_LOG_INFO(...)    NRF_LOG_INFO(__VA_ARGS__)
+#define PORT_LOG_WARNING(...) NRF_LOG_WARNING(__VA_ARGS__)
+
+// DWT cycle counter, zeroed on start.
+#define PORT_CYCLE_COUNTER_START()                          \
+    do {                                                    \
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     \
+        DWT->CYCCNT = 0;                                    \
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;                \
+    } while (0)
+
+static inline uint32_t port_cycle_counter_get(void) {
+    return DWT->CYCCNT;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,275 @@
+#include "report_state.h"
+
+#include <string.h>
+
+#include "../firmware_config.h"
+
+#define KEY_SLOT 2 // First key byte of the keyboard report.
+
+static uint8_t m_modifier_counts[8];               // Keys holding each modifier bit.
+static uint8_t m_key_counts[NKRO_USAGE_MAX + 1];   // Keys holding each usage.
+static uint8_t m_keys_down;                        // Usages held, with or without a slot.
+static uint8_t m_keys_left_out;                    // Usages held without a slot in the keyboard report.
+
+static uint8_t m_kb[KB_INPUT_REPORT_MAX_LEN];
+static uint8_t m_nkro[NKRO_INPUT_REPORT_MAX_LEN];
+static uint16_t m_cc[CC_USAGE_SLOTS];
+static uint8_t m_cc_counts[CC_USAGE_SLOTS]; // Keys holding the usage of each slot.
+static uint8_t m_system;
+
+// Reports as last taken. A report changed and changed back in between is not taken again.
+static uint8_t m_kb_taken[KB_INPUT_REPORT_MAX_LEN];
+static uint8_t m_nkro_taken[NKRO_INPUT_REPORT_MAX_LEN];
+static uint16_t m_cc_taken[CC_USAGE_SLOTS];
+static uint8_t m_system_taken;
+
+static bool m_kb_changed;
+static bool m_nkro_changed;
+static bool m_cc_changed;
+static bool m_system_changed;
+
+static bool has_slot(uint8_t key) {
+    for (int i = KEY_SLOT; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+        if (m_kb[i] == key) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void slot_take(uint8_t key) {
+    for (int i = KEY_SLOT; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+        if (m_kb[i] == 0) {
+            m_kb[i] = key;
+            m_kb_changed = true;
+            return;
+        }
+    }
+
+    m_keys_left_out++;
+}
+
+// A freed slot goes to a usage that was left out, the bitmap tells which are held.
+static void slot_free(uint8_t key) {
+    for (int i = KEY_SLOT; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+        if (m_kb[i] != key) {
+            continue;
+        }
+
+        m_kb[i] = 0;
+        m_kb_changed = true;
+
+        for (int usage = 0; m_keys_left_out != 0 && usage <= NKRO_USAGE_MAX; usage++) {
+            if ((m_nkro[1 + usage / 8] & (1U << (usage % 8))) && !has_slot(usage)) {
+                m_kb[i] = usage;
+                m_keys_left_out--;
+                break;
+            }
+        }
+
+        return;
+    }
+
+    m_keys_left_out--;
+}
+
+void report_state_init(void) {
+    memset(m_modifier_counts, 0, sizeof(m_modifier_counts));
+    memset(m_key_counts, 0, sizeof(m_key_counts));
+    m_keys_down = 0;
+    m_keys_left_out = 0;
+
+    memset(m_kb, 0, sizeof(m_kb));
+    memset(m_nkro, 0, sizeof(m_nkro));
+    memset(m_cc, 0, sizeof(m_cc));
+    memset(m_cc_counts, 0, sizeof(m_cc_counts));
+    m_system = 0;
+
+    memset(m_kb_taken, 0, sizeof(m_kb_taken));
+    memset(m_nkro_taken, 0, sizeof(m_nkro_taken));
+    memset(m_cc_taken, 0, sizeof(m_cc_taken));
+    m_system_taken = 0;
+
+    m_kb_changed = false;
+    m_nkro_changed = false;
+    m_cc_changed = false;
+    m_system_changed = false;
+}
+
+void report_state_modifiers(uint8_t modifiers, bool pressed) {
+    uint8_t byte = m_kb[0];
+
+    while (modifiers != 0) {
+        int bit = __builtin_ctz(modifiers);
+
+        modifiers &= modifiers - 1;
+
+        if (pressed) {
+            m_modifier_counts[bit]++;
+            byte |= 1U << bit;
+        } else if (m_modifier_counts[bit] != 0 && --m_modifier_counts[bit] == 0) {
+            byte &= ~(1U << bit);
+        }
+    }
+
+    if (byte != m_kb[0]) {
+        m_kb[0] = byte;
+        m_nkro[0] = byte;
+        m_kb_changed = true;
+        m_nkro_changed = true;
+    }
+}
+
+void report_state_key(uint8_t key, bool pressed) {
+    if (key == 0 || key > NKRO_USAGE_MAX) {
+        return;
+    }
+
+    uint8_t *p_byte = &m_nkro[1 + key / 8];
+    uint8_t bit = 1U << (key % 8);
+
+    if (pressed) {
+        if (m_key_counts[key]++ != 0) {
+            return;
+        }
+
+        *p_byte |= bit;
+        m_keys_down++;
+
+        slot_take(key);
+    } else {
+        if (m_key_counts[key] == 0 || --m_key_counts[key] != 0) {
+            return;
+        }
+
+        *p_byte &= ~bit;
+        m_keys_down--;
+
+        slot_free(key);
+    }
+
+    m_nkro_changed = true;
+}
+
+void report_state_consumer(uint16_t usage, bool pressed) {
+    int free_slot = -1;
+
+    if (usage == 0) {
+        return;
+    }
+
+    for (int i = 0; i < CC_USAGE_SLOTS; i++) {
+        if (m_cc[i] == usage) {
+            if (pressed) {
+                m_cc_counts[i]++;
+            } else if (--m_cc_counts[i] == 0) {
+                m_cc[i] = 0;
+                m_cc_changed = true;
+            }
+
+            return;
+        }
+
+        if (m_cc[i] == 0 && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+
+    if (pressed && free_slot >= 0) {
+        m_cc[free_slot] = usage;
+        m_cc_counts[free_slot] = 1;
+        m_cc_changed = true;
+    }
+}
+
+void report_state_system(uint8_t usage, bool pressed) {
+    if (pressed && m_system != usage) {
+        m_system = usage;
+        m_system_changed = true;
+    } else if (!pressed && m_system == usage && usage != 0) {
+        m_system = 0;
+        m_system_changed = true;
+    }
+}
+
+bool report_state_kb_take(uint8_t *p_report) {
+    if (!m_kb_changed) {
+        return false;
+    }
+
+    m_kb_changed = false;
+
+    if (memcmp(m_kb, m_kb_taken, sizeof(m_kb)) == 0) {
+        return false;
+    }
+
+    memcpy(m_kb_taken, m_kb, sizeof(m_kb));
+    memcpy(p_report, m_kb, sizeof(m_kb));
+
+    return true;
+}
+
+bool report_state_nkro_take(uint8_t *p_report) {
+    if (!m_nkro_changed) {
+        return false;
+    }
+
+    m_nkro_changed = false;
+
+    if (memcmp(m_nkro, m_nkro_taken, sizeof(m_nkro)) == 0) {
+        return false;
+    }
+
+    memcpy(m_nkro_taken, m_nkro, sizeof(m_nkro));
+    memcpy(p_report, m_nkro, sizeof(m_nkro));
+
+    return true;
+}
+
+bool report_state_cc_take(uint16_t *p_usages) {
+    if (!m_cc_changed) {
+        return false;
+    }
+
+    m_cc_changed = false;
+
+    if (memcmp(m_cc, m_cc_taken, sizeof(m_cc)) == 0) {
+        return false;
+    }
+
+    memcpy(m_cc_taken, m_cc, sizeof(m_cc));
+    memcpy(p_usages, m_cc, sizeof(m_cc));
+
+    return true;
+}
+
+bool report_state_system_take(uint8_t *p_usage) {
+    if (!m_system_changed) {
+        return false;
+    }
+
+    m_system_changed = false;
+
+    if (m_system == m_system_taken) {
+        return false;
+    }
+
+    m_system_taken = m_system;
+    *p_usage = m_system;
+
+    return true;
+}
+
+void report_state_kb_resend(void) {
+    // No report has every byte 0xFF, both compare as changed.
+    memset(m_kb_taken, 0xFF, sizeof(m_kb_taken));
+    memset(m_nkro_taken, 0xFF, sizeof(m_nkro_taken));
+
+    m_kb_changed = true;
+    m_nkro_changed = true;
+}
+
+bool report_state_kb_is_empty(void) {
+    return m_kb[0] == 0 && m_keys_down == 0;
+}
@@ -0,0 +1,37 @@
+#ifndef _REPORT_STATE_H_
+#define _REPORT_STATE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Live HID report state.
+ * The keyboard, NKRO, consumer and system reports are kept as they stand and every press or release only updates the
+ * modifier bit, key slot, bitmap bit or usage it touches. Modifiers and keys are counted, so two keys holding the
+ * same one keep it down until both are released. A report is only taken when its bytes differ from the last one taken.
+ */
+
+void report_state_init(void);
+
+void report_state_modifiers(uint8_t modifiers, bool pressed);
+
+void report_state_key(uint8_t key, bool pressed);
+
+// A usage takes a free slot of the consumer report, it is left out while all CC_USAGE_SLOTS are taken.
+void report_state_consumer(uint16_t usage, bool pressed);
+
+void report_state_system(uint8_t usage, bool pressed);
+
+// Copies the report into p_report if its bytes differ from when it was last taken. Returns false if they do not.
+bool report_state_kb_take(uint8_t *p_report);
+bool report_state_nkro_take(uint8_t *p_report);
+bool report_state_cc_take(uint16_t *p_usages);
+bool report_state_system_take(uint8_t *p_usage);
+
+// Keyboard and NKRO reports are taken again on the next call, even if unchanged.
+void report_state_kb_resend(void);
+
+// No modifier or key is down.
+bool report_state_kb_is_empty(void);
+
+#endif
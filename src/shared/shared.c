@@ -1,6 +1,8 @@
 #include "shared.h"
 
 #include "app_scheduler.h"
+#include "app_timer.h"
+#include "app_util.h"
 #include "ble_conn_params.h"
 #include "nrf_gpio.h"
 #include "nrf_log_ctrl.h"
@@ -11,6 +13,11 @@
 #include "../config/keyboard.h"
 #include "../error_handler/error_handler.h"
 #include "../firmware_config.h"
+#include "../uptime/uptime.h"
+
+APP_TIMER_DEF(m_uptime_timer_id);
+
+static void uptime_timeout_handler(void *p_context);
 
 /*
  * nRF52 section.
@@ -115,3 +122,28 @@ void pins_init(void) {
         nrf_gpio_cfg_input(ROWS[i], NRF_GPIO_PIN_PULLDOWN);
     }
 }
+
+// Waiting on sense nothing else reads the uptime, a timer does so it never misses an app_timer wrap.
+void uptime_start(void) {
+    ret_code_t err_code;
+    uptime_init_t init = {0};
+
+    NRF_LOG_INFO("uptime_start.");
+
+    init.counter_get = app_timer_cnt_get;
+    init.counter_hz = APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1);
+
+    uptime_init(&init);
+
+    err_code = app_timer_create(&m_uptime_timer_id, APP_TIMER_MODE_REPEATED, uptime_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_uptime_timer_id, APP_TIMER_TICKS(UPTIME_READ_INTERVAL), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void uptime_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+
+    uptime_ms_get();
+}
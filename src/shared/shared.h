@@ -17,5 +17,6 @@ void scheduler_init(void);
  * Firmware section.
  */
 void pins_init(void);
+void uptime_start(void);
 
 #endif
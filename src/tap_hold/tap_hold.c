@@ -0,0 +1,160 @@
+#include "tap_hold.h"
+
+#include <string.h>
+
+#include "../firmware_config.h"
+#include "../keycodes.h"
+
+#define TICKS_MASK 0x00FFFFFF // Event clock is 24 bits, as the RTC counter.
+
+static tap_hold_code_get_t m_code_get;
+static tap_hold_evt_handler_t m_evt_handler;
+static uint32_t (*m_ticks_get)(uint32_t ms);
+
+// Undecided key.
+static bool m_undecided;
+static key_event_t m_press;
+static uint32_t m_code;
+static uint32_t m_term; // In ticks.
+
+// Events not through the engine yet, in order. The first m_examined ones were seen by the undecided key.
+static key_event_t m_queue[TAP_HOLD_QUEUE_SIZE];
+static uint8_t m_queue_count;
+static uint8_t m_examined;
+
+static void decide(bool hold) {
+    m_undecided = false;
+    m_examined = 0; // Queued events go through the engine again, the decision may change their code.
+
+    m_evt_handler(&m_press, hold ? HOLD_CODE(m_code) : TAP_CODE(m_code));
+}
+
+static bool term_passed(uint32_t now) {
+    return ((now - m_press.timestamp) & TICKS_MASK) >= m_term;
+}
+
+static bool pressed_since(int8_t key_index) {
+    for (int i = 0; i < m_examined; i++) {
+        if (m_queue[i].key_index == key_index && m_queue[i].pressed) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Event at the front of the queue while no key is undecided.
+static void event_pass(key_event_t const *p_event) {
+    if (!p_event->pressed) {
+        m_evt_handler(p_event, 0);
+        return;
+    }
+
+    uint32_t code = m_code_get(p_event);
+
+    if (!IS_TAP_HOLD(code)) {
+        m_evt_handler(p_event, code);
+        return;
+    }
+
+    uint32_t term_ms = TAP_HOLD_TERM_STEPS(code) != 0 ? TAP_HOLD_TERM_STEPS(code) * TAPPING_TERM_STEP : TAPPING_TERM;
+
+    m_undecided = true;
+    m_press = *p_event;
+    m_code = code;
+    m_term = m_ticks_get(term_ms);
+}
+
+// Queued event seen by the undecided key. Returns true if it decided the key.
+static bool event_examine(key_event_t const *p_event) {
+    // Events are in order, one after the term means the key was held through it.
+    if (term_passed(p_event->timestamp)) {
+        decide(true);
+        return true;
+    }
+
+    if (p_event->key_index == m_press.key_index) {
+        if (!p_event->pressed) {
+            decide(false);
+            return true;
+        }
+
+        return false;
+    }
+
+    if (p_event->pressed) {
+        if (TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS) {
+            decide(true);
+            return true;
+        }
+
+        return false;
+    }
+
+    if (TAP_HOLD_PERMISSIVE_HOLD && pressed_since(p_event->key_index)) {
+        decide(true);
+        return true;
+    }
+
+    return false;
+}
+
+static void queue_run(void) {
+    while (m_examined < m_queue_count) {
+        if (m_undecided) {
+            if (!event_examine(&m_queue[m_examined])) {
+                m_examined++;
+            }
+
+            continue;
+        }
+
+        key_event_t event = m_queue[0];
+
+        m_queue_count--;
+        memmove(&m_queue[0], &m_queue[1], m_queue_count * sizeof(key_event_t));
+
+        event_pass(&event);
+    }
+}
+
+void tap_hold_init(tap_hold_init_t const *p_init) {
+    m_code_get = p_init->code_get;
+    m_evt_handler = p_init->evt_handler;
+    m_ticks_get = p_init->ticks_get;
+
+    m_undecided = false;
+    m_queue_count = 0;
+    m_examined = 0;
+}
+
+void tap_hold_event_process(key_event_t const *p_event) {
+    // No room left to wait, the key has been held through everything queued.
+    if (m_queue_count == TAP_HOLD_QUEUE_SIZE) {
+        decide(true);
+        queue_run();
+    }
+
+    m_queue[m_queue_count++] = *p_event;
+
+    queue_run();
+}
+
+void tap_hold_tick(uint32_t now) {
+    if (!m_undecided || !term_passed(now)) {
+        return;
+    }
+
+    decide(true);
+    queue_run();
+}
+
+bool tap_hold_deadline_get(uint32_t *p_deadline) {
+    if (!m_undecided) {
+        return false;
+    }
+
+    *p_deadline = (m_press.timestamp + m_term) & TICKS_MASK;
+
+    return true;
+}
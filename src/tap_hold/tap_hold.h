@@ -0,0 +1,41 @@
+#ifndef _TAP_HOLD_H_
+#define _TAP_HOLD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../key_event/key_event.h"
+
+/*
+ * Tap hold engine, between key events and translation.
+ * A tap hold key stays undecided from its press until it is released (tap), its term runs out (hold), or another
+ * key decides it by permissive hold or hold on other key press. Events behind an undecided key wait in a bounded
+ * queue and go on in order once it is decided. Decisions are taken on the event or tick that makes them certain.
+ *
+ * Time only comes from event timestamps, tap_hold_tick and the ticks_get conversion given at init, so a host build
+ * can drive it with any clock counting up to 24 bits.
+ */
+
+// Code of a press on the current layer, asked when the press reaches the engine.
+typedef uint32_t (*tap_hold_code_get_t)(key_event_t const *p_event);
+
+// Presses come with the code to translate, a tap hold key comes with its tap or hold code. Releases come with 0.
+typedef void (*tap_hold_evt_handler_t)(key_event_t const *p_event, uint32_t code);
+
+typedef struct {
+    tap_hold_code_get_t code_get;
+    tap_hold_evt_handler_t evt_handler;
+    uint32_t (*ticks_get)(uint32_t ms); // Ticks of the event clock in ms, RTC ticks on target.
+} tap_hold_init_t;
+
+void tap_hold_init(tap_hold_init_t const *p_init);
+
+void tap_hold_event_process(key_event_t const *p_event);
+
+// Decide an undecided key whose term ran out at now, in ticks of the event clock.
+void tap_hold_tick(uint32_t now);
+
+// Returns false if no key is undecided, else the tick its term runs out.
+bool tap_hold_deadline_get(uint32_t *p_deadline);
+
+#endif
@@ -0,0 +1,32 @@
+#include "uptime.h"
+
+#include "../port/port.h"
+
+static uint32_t (*m_counter_get)(void);
+static uint32_t m_counter_hz;
+static uint32_t m_counter_last; // Counter at the last read.
+static uint64_t m_ticks;        // Counter ticks since init.
+
+void uptime_init(uptime_init_t const *p_init) {
+    m_counter_get = p_init->counter_get;
+    m_counter_hz = p_init->counter_hz;
+    m_counter_last = m_counter_get();
+    m_ticks = 0;
+}
+
+uint32_t uptime_ms_get(void) {
+    uint32_t ms;
+
+    // Read from interrupt handlers too, the counter and the sum move together.
+    PORT_CRITICAL_REGION_ENTER();
+
+    uint32_t counter = m_counter_get();
+
+    m_ticks += (counter - m_counter_last) & UPTIME_COUNTER_MASK;
+    m_counter_last = counter;
+    ms = (uint32_t)(m_ticks * 1000 / m_counter_hz);
+
+    PORT_CRITICAL_REGION_EXIT();
+
+    return ms;
+}
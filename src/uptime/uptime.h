@@ -0,0 +1,20 @@
+#ifndef _UPTIME_H_
+#define _UPTIME_H_
+
+#include <stdint.h>
+
+// app_timer counts 24 bits on RTC1.
+#define UPTIME_COUNTER_MASK 0x00FFFFFF
+
+typedef struct {
+    uint32_t (*counter_get)(void); // Free running counter, app_timer_cnt_get on target.
+    uint32_t counter_hz;           // Counter ticks per second.
+} uptime_init_t;
+
+void uptime_init(uptime_init_t const *p_init);
+
+// Time since init in ms, wrapping after 49 days. Sees one counter wrap at most between calls, 512 s at 32768 Hz, so
+// something must call it at least that often.
+uint32_t uptime_ms_get(void);
+
+#endif
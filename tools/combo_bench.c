@@ -0,0 +1,265 @@
+/*
+ * Combo benchmark, runs on the host.
+ * Types a stream of single keys and combo chords through the combo engine with tables of 4, 32 and 200 random combos,
+ * and through a reference that scans the whole table on every press. Prints the time per event of both and checks
+ * that every chord came out as its combo and every single key as itself.
+ *
+ * Build and run from the project folder:
+ * cc -O2 -DHOST_BUILD -DMASTER -DCOMBO_NUM_MAX=224 -Isrc -o combo_bench tools/combo_bench.c src/combo/combo.c
+ * ./combo_bench [events]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "combo/combo.h"
+
+#define EVENTS      2000000 // Key events typed for each table.
+#define CHORD_ODDS  4       // One in this many strokes is a combo chord.
+#define STREAM_SIZE 65536   // Events of the stream, replayed until the event count is reached.
+
+static const uint16_t TABLE_SIZES[] = {4, 32, 200};
+
+static uint32_t m_seed = 0x2545F491;
+static uint32_t m_combos[COMBO_NUM_MAX][COMBO_KEY_MAX + 1];
+static uint16_t m_combo_num;
+
+static key_event_t m_stream[STREAM_SIZE];
+static uint32_t m_stream_size;
+static uint32_t m_chords;  // Chords in the stream.
+static uint32_t m_singles; // Single key presses in the stream.
+
+static uint32_t m_fired;  // Presses that came out as a combo.
+static uint32_t m_passed; // Presses that came out as a single key.
+static volatile uint32_t m_sink;
+
+static uint32_t random_get(uint32_t limit) {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    return m_seed % limit;
+}
+
+static bool combo_has(uint16_t combo, uint32_t key_index) {
+    for (int i = 1; i <= COMBO_KEY_MAX; i++) {
+        if (m_combos[combo][i] == key_index) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint64_t combo_keys_get(uint16_t combo) {
+    uint64_t keys = 0;
+
+    for (int i = 1; i <= COMBO_KEY_MAX; i++) {
+        keys |= m_combos[combo][i] != 0 ? 1ULL << (m_combos[combo][i] - 1) : 0;
+    }
+
+    return keys;
+}
+
+// Two or three distinct keys each, no two combos with the same keys.
+static void table_build(uint16_t combo_num) {
+    memset(m_combos, 0, sizeof(m_combos));
+    m_combo_num = combo_num;
+
+    for (uint16_t combo = 0; combo < combo_num; combo++) {
+        bool unique = false;
+
+        while (!unique) {
+            uint8_t size = 2 + random_get(2);
+
+            memset(m_combos[combo], 0, sizeof(m_combos[combo]));
+            m_combos[combo][0] = 0x1000 + combo;
+
+            for (int i = 1; i <= size; i++) {
+                uint32_t key_index;
+
+                do {
+                    key_index = 1 + random_get(KEY_INDEX_MAX);
+                } while (combo_has(combo, key_index));
+
+                m_combos[combo][i] = key_index;
+            }
+
+            unique = true;
+
+            for (uint16_t other = 0; other < combo && unique; other++) {
+                unique = combo_keys_get(combo) != combo_keys_get(other);
+            }
+        }
+    }
+}
+
+static void stream_put(int8_t key_index, bool pressed, uint32_t now) {
+    key_event_t *p_event = &m_stream[m_stream_size++];
+
+    memset(p_event, 0, sizeof(key_event_t));
+    p_event->key_index = key_index;
+    p_event->pressed = pressed;
+    p_event->timestamp = now;
+}
+
+// Strokes are far enough apart that no combo window spans two of them.
+static void stream_build(void) {
+    uint32_t now = 0;
+
+    m_stream_size = 0;
+    m_chords = 0;
+    m_singles = 0;
+
+    while (m_stream_size + 2 * COMBO_KEY_MAX <= STREAM_SIZE) {
+        if (random_get(CHORD_ODDS) == 0) {
+            uint16_t combo = random_get(m_combo_num);
+
+            for (int i = 1; i <= COMBO_KEY_MAX && m_combos[combo][i] != 0; i++) {
+                stream_put(m_combos[combo][i], true, now + i * 5);
+            }
+
+            for (int i = 1; i <= COMBO_KEY_MAX && m_combos[combo][i] != 0; i++) {
+                stream_put(m_combos[combo][i], false, now + 100 + i * 5);
+            }
+
+            m_chords++;
+        } else {
+            int8_t key_index = 1 + random_get(KEY_INDEX_MAX);
+
+            stream_put(key_index, true, now);
+            stream_put(key_index, false, now + 80);
+            m_singles++;
+        }
+
+        now += 2 * COMBO_TERM + 200;
+    }
+}
+
+static void evt_handler(key_event_t const *p_event) {
+    if (!p_event->pressed) {
+        return;
+    }
+
+    if (p_event->combo != 0) {
+        m_fired++;
+    } else {
+        m_passed++;
+    }
+}
+
+static uint32_t ticks_get(uint32_t ms) {
+    return ms;
+}
+
+static void engine_init(void) {
+    combo_init_t init = {0};
+
+    init.p_combos = (uint32_t const (*)[COMBO_KEY_MAX + 1])m_combos;
+    init.combo_num = m_combo_num;
+    init.evt_handler = evt_handler;
+    init.ticks_get = ticks_get;
+
+    combo_init(&init);
+
+    m_fired = 0;
+    m_passed = 0;
+}
+
+// Reference matcher: every press walks the table for combos holding the keys down so far.
+static uint32_t scan_press(int8_t const *p_down, uint8_t down_count) {
+    uint32_t matches = 0;
+
+    for (uint16_t combo = 0; combo < m_combo_num; combo++) {
+        bool all = true;
+
+        for (int i = 0; i < down_count && all; i++) {
+            all = combo_has(combo, p_down[i]);
+        }
+
+        matches += all;
+    }
+
+    return matches;
+}
+
+static double seconds_get(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void table_run(uint16_t combo_num, uint32_t events) {
+    table_build(combo_num);
+    stream_build();
+
+    // One pass over the stream checks the outcome.
+    engine_init();
+
+    for (uint32_t i = 0; i < m_stream_size; i++) {
+        combo_event_process(&m_stream[i]);
+    }
+
+    if (m_fired != m_chords || m_passed != m_singles) {
+        printf("%u combos: %u of %u chords fired, %u of %u single keys passed.\n", combo_num, m_fired, m_chords,
+               m_passed, m_singles);
+        exit(1);
+    }
+
+    // Every replay of the stream comes later, so no window spans two replays.
+    uint32_t period = m_stream[m_stream_size - 1].timestamp + 2 * COMBO_TERM + 200;
+    double start = seconds_get();
+
+    for (uint32_t i = 0; i < events; i++) {
+        key_event_t event = m_stream[i % m_stream_size];
+
+        event.timestamp = (event.timestamp + (i / m_stream_size + 1) * period) & 0x00FFFFFF;
+        combo_event_process(&event);
+    }
+
+    double engine_ns = (seconds_get() - start) * 1e9 / events;
+
+    int8_t down[KEY_INDEX_MAX];
+    uint8_t down_count = 0;
+
+    start = seconds_get();
+
+    for (uint32_t i = 0; i < events; i++) {
+        key_event_t const *p_event = &m_stream[i % m_stream_size];
+
+        if (p_event->pressed) {
+            down[down_count++] = p_event->key_index;
+            m_sink += scan_press(down, down_count);
+        } else {
+            down_count = 0;
+        }
+    }
+
+    double scan_ns = (seconds_get() - start) * 1e9 / events;
+
+    printf("%6u  %11.1f  %9.1f\n", combo_num, engine_ns, scan_ns);
+}
+
+int main(int argc, char **argv) {
+    uint32_t events = argc > 1 ? strtoul(argv[1], NULL, 10) : EVENTS;
+
+    printf("%i key indexes, up to %i combos of 2 or 3 keys. Time per key event.\n", KEY_INDEX_MAX, COMBO_NUM_MAX);
+    printf("combos  engine ns    scan ns\n");
+
+    for (size_t i = 0; i < sizeof(TABLE_SIZES) / sizeof(TABLE_SIZES[0]); i++) {
+        if (TABLE_SIZES[i] > COMBO_NUM_MAX) {
+            printf("COMBO_NUM_MAX is below %u, build with -DCOMBO_NUM_MAX=224.\n", TABLE_SIZES[i]);
+            return 1;
+        }
+
+        table_run(TABLE_SIZES[i], events);
+    }
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * Connection policy checks, runs on the host.
+ * A fake uptime clock, request callback and idle timer stand for uptime, ble_conn_params and the app timer. Checks
+ * the fast to idle and idle to fast transitions, the idle timer waiting again for the quiet time left, refused
+ * requests asked again, and the granted interval stats.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o conn_policy_check tools/conn_policy_check.c src/conn_policy/conn_policy.c
+ * ./conn_policy_check
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "conn_policy/conn_policy.h"
+#include "port/port.h"
+#include "firmware_config.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+static uint32_t m_ms;
+static bool m_refuse;
+static uint32_t m_requests;
+static conn_policy_params_t m_requested;
+static bool m_timer_running;
+static uint32_t m_timer_expiry;
+
+static uint32_t ms_get(void) {
+    return m_ms;
+}
+
+static bool params_request(conn_policy_params_t const *p_params) {
+    if (m_refuse) {
+        return false;
+    }
+
+    m_requests++;
+    m_requested = *p_params;
+
+    return true;
+}
+
+static void timer_start(uint32_t ms) {
+    CHECK(!m_timer_running);
+    CHECK(ms > 0 && ms <= CONN_IDLE_TIMEOUT);
+
+    m_timer_running = true;
+    m_timer_expiry = m_ms + ms;
+}
+
+// Moves the clock on, the idle timer runs out on its way.
+static void wait(uint32_t ms) {
+    uint32_t end = m_ms + ms;
+
+    while (m_timer_running && m_timer_expiry <= end) {
+        m_ms = m_timer_expiry;
+        m_timer_running = false;
+        conn_policy_timeout();
+    }
+
+    m_ms = end;
+}
+
+static conn_policy_params_t params(uint16_t interval, uint16_t latency) {
+    conn_policy_params_t params = {interval, interval, latency, CONN_SUP_TIMEOUT};
+
+    return params;
+}
+
+static void connect(void) {
+    conn_policy_init_t init = {ms_get, params_request, timer_start};
+    conn_policy_params_t granted = params(MASTER_MAX_CONN_INTERVAL, SLAVE_LATENCY);
+
+    m_ms = 1000;
+    m_refuse = false;
+    m_requests = 0;
+    m_timer_running = false;
+
+    conn_policy_init(&init);
+    conn_policy_connected(&granted);
+
+    CHECK(conn_policy_get() == CONN_POLICY_FAST);
+    CHECK(m_requests == 0);
+    CHECK(m_timer_running);
+}
+
+// No reports for the idle timeout asks for idle parameters, the next report asks for fast ones at once.
+static void check_idle_and_back(void) {
+    connect();
+
+    wait(CONN_IDLE_TIMEOUT - 1);
+    CHECK(conn_policy_get() == CONN_POLICY_FAST);
+    CHECK(m_requests == 0);
+
+    wait(1);
+    CHECK(conn_policy_get() == CONN_POLICY_IDLE);
+    CHECK(m_requests == 1);
+    CHECK(m_requested.min_conn_interval == CONN_IDLE_MIN_INTERVAL);
+    CHECK(m_requested.max_conn_interval == CONN_IDLE_MAX_INTERVAL);
+    CHECK(m_requested.slave_latency == CONN_IDLE_SLAVE_LATENCY);
+
+    // Idle waits for the next report, no timer runs.
+    CHECK(!m_timer_running);
+    wait(10 * CONN_IDLE_TIMEOUT);
+    CHECK(m_requests == 1);
+
+    conn_policy_activity();
+    CHECK(conn_policy_get() == CONN_POLICY_FAST);
+    CHECK(m_requests == 2);
+    CHECK(m_requested.min_conn_interval == MASTER_MIN_CONN_INTERVAL);
+    CHECK(m_requested.max_conn_interval == MASTER_MAX_CONN_INTERVAL);
+    CHECK(m_requested.slave_latency == SLAVE_LATENCY);
+    CHECK(m_timer_running);
+
+    // Reports while fast ask for nothing.
+    conn_policy_activity();
+    CHECK(m_requests == 2);
+}
+
+// Reports do not restart the timer, when it runs out it waits again for the quiet time left.
+static void check_timer_waits_again(void) {
+    connect();
+
+    wait(CONN_IDLE_TIMEOUT / 2);
+    conn_policy_activity();
+
+    wait(CONN_IDLE_TIMEOUT / 2);
+    CHECK(conn_policy_get() == CONN_POLICY_FAST);
+    CHECK(m_timer_running);
+    CHECK(m_timer_expiry == m_ms + CONN_IDLE_TIMEOUT / 2);
+
+    wait(CONN_IDLE_TIMEOUT / 2 - 1);
+    CHECK(conn_policy_get() == CONN_POLICY_FAST);
+
+    wait(1);
+    CHECK(conn_policy_get() == CONN_POLICY_IDLE);
+    CHECK(m_requests == 1);
+}
+
+// A refused request is asked again on the next grant or report.
+static void check_refused(void) {
+    conn_policy_params_t granted = params(MASTER_MAX_CONN_INTERVAL, SLAVE_LATENCY);
+    conn_policy_stats_t stats;
+
+    connect();
+
+    m_refuse = true;
+    wait(CONN_IDLE_TIMEOUT);
+    CHECK(conn_policy_get() == CONN_POLICY_IDLE);
+    CHECK(m_requests == 0);
+
+    m_refuse = false;
+    conn_policy_granted(&granted);
+    CHECK(m_requests == 1);
+    CHECK(m_requested.slave_latency == CONN_IDLE_SLAVE_LATENCY);
+
+    m_refuse = true;
+    conn_policy_activity();
+    CHECK(m_requests == 1);
+
+    m_refuse = false;
+    conn_policy_activity();
+    CHECK(m_requests == 2);
+    CHECK(m_requested.slave_latency == SLAVE_LATENCY);
+
+    conn_policy_stats_get(&stats);
+    CHECK(stats.refused == 2);
+    CHECK(stats.requests[CONN_POLICY_IDLE] == 1);
+    CHECK(stats.requests[CONN_POLICY_FAST] == 1);
+}
+
+// Nothing is asked for without a link. A timer left from the last link waits again once connected.
+static void check_disconnected(void) {
+    conn_policy_params_t granted = params(MASTER_MAX_CONN_INTERVAL, SLAVE_LATENCY);
+
+    connect();
+
+    wait(CONN_IDLE_TIMEOUT / 2);
+    conn_policy_disconnected();
+    conn_policy_activity();
+    CHECK(m_requests == 0);
+
+    conn_policy_connected(&granted);
+    CHECK(m_timer_running);
+
+    wait(CONN_IDLE_TIMEOUT / 2);
+    CHECK(conn_policy_get() == CONN_POLICY_FAST);
+    CHECK(m_timer_running);
+
+    wait(CONN_IDLE_TIMEOUT / 2);
+    CHECK(conn_policy_get() == CONN_POLICY_IDLE);
+    CHECK(m_requests == 1);
+
+    // Runs out with no link.
+    conn_policy_activity();
+    conn_policy_disconnected();
+    wait(2 * CONN_IDLE_TIMEOUT);
+    CHECK(!m_timer_running);
+    CHECK(m_requests == 2);
+}
+
+static void check_stats(void) {
+    conn_policy_params_t idle = params(CONN_IDLE_MAX_INTERVAL, CONN_IDLE_SLAVE_LATENCY);
+    conn_policy_params_t fast = params(MASTER_MIN_CONN_INTERVAL, 0);
+    conn_policy_stats_t stats;
+
+    connect();
+
+    conn_policy_granted(&idle);
+    conn_policy_granted(&fast);
+
+    conn_policy_stats_get(&stats);
+    CHECK(stats.grants == 3);
+    CHECK(stats.interval_fastest == MASTER_MIN_CONN_INTERVAL);
+    CHECK(stats.interval_slowest == CONN_IDLE_MAX_INTERVAL);
+    CHECK(stats.latency_max == CONN_IDLE_SLAVE_LATENCY);
+    CHECK(stats.granted.max_conn_interval == MASTER_MIN_CONN_INTERVAL);
+    CHECK(stats.granted.slave_latency == 0);
+}
+
+int main(void) {
+    check_idle_and_back();
+    check_timer_waits_again();
+    check_refused();
+    check_disconnected();
+    check_stats();
+
+    printf("ok\n");
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Cycle stats checks, runs on the host.
+ * A fake cycle source stands for the DWT counter, so every recorded count is known. Checks min, max and mean, the
+ * log2 histogram bin edges, and stage timing across a counter wrap.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -DCYCLE_STATS_ENABLED=1 -Isrc -o cycle_stats_check tools/cycle_stats_check.c \
+ *    src/cycle_stats/cycle_stats.c
+ * ./cycle_stats_check
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cycle_stats/cycle_stats.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define LAST_BIN (CYCLE_STATS_HISTOGRAM_BINS - 1)
+
+static uint32_t m_cycles;
+
+static uint32_t cycles_get(void) {
+    return m_cycles;
+}
+
+// Bin a single count of cycles lands in.
+static int bin_of(uint32_t cycles) {
+    cycle_stats_init(cycles_get);
+    cycle_stats_record(CYCLE_STATS_UPDATE, cycles);
+
+    cycle_stats_t const *p_stats = cycle_stats_get(CYCLE_STATS_UPDATE);
+    int found = -1;
+
+    for (int bin = 0; bin < CYCLE_STATS_HISTOGRAM_BINS; bin++) {
+        if (p_stats->histogram[bin] > 0) {
+            CHECK(found == -1 && p_stats->histogram[bin] == 1);
+            found = bin;
+        }
+    }
+
+    return found;
+}
+
+static void check_min_max_mean(void) {
+    cycle_stats_init(cycles_get);
+
+    cycle_stats_record(CYCLE_STATS_TRANSLATE, 300);
+    cycle_stats_record(CYCLE_STATS_TRANSLATE, 100);
+    cycle_stats_record(CYCLE_STATS_TRANSLATE, 200);
+    cycle_stats_record(CYCLE_STATS_TRANSLATE, UINT32_MAX);
+
+    cycle_stats_t const *p_stats = cycle_stats_get(CYCLE_STATS_TRANSLATE);
+
+    CHECK(p_stats->count == 4);
+    CHECK(p_stats->min == 100);
+    CHECK(p_stats->max == UINT32_MAX);
+    CHECK(p_stats->sum == 600ULL + UINT32_MAX);
+    CHECK(cycle_stats_get(CYCLE_STATS_GENERATE)->count == 0);
+}
+
+// Bin n counts cycles in [2^(n-1), 2^n), the last bin takes the rest.
+static void check_bin_edges(void) {
+    CHECK(bin_of(0) == 0);
+    CHECK(bin_of(1) == 1);
+    CHECK(bin_of(2) == 2);
+    CHECK(bin_of(3) == 2);
+    CHECK(bin_of(4) == 3);
+
+    for (int bin = 2; bin < LAST_BIN; bin++) {
+        CHECK(bin_of(1UL << (bin - 1)) == bin);
+        CHECK(bin_of((1UL << bin) - 1) == bin);
+    }
+
+    CHECK(bin_of(1UL << (LAST_BIN - 1)) == LAST_BIN);
+    CHECK(bin_of(UINT32_MAX) == LAST_BIN);
+}
+
+// Stage timing subtracts across the wrap of the cycle counter.
+static void check_counter_wrap(void) {
+    cycle_stats_init(cycles_get);
+    m_cycles = UINT32_MAX - 10;
+
+    CYCLE_STATS_BEGIN(scan);
+    m_cycles += 100;
+    CYCLE_STATS_END(scan, CYCLE_STATS_SCAN);
+
+    cycle_stats_t const *p_stats = cycle_stats_get(CYCLE_STATS_SCAN);
+
+    CHECK(p_stats->count == 1);
+    CHECK(p_stats->min == 100 && p_stats->max == 100);
+}
+
+// Histogram bins stop at UINT16_MAX instead of wrapping.
+static void check_saturation(void) {
+    cycle_stats_init(cycles_get);
+
+    for (uint32_t i = 0; i < UINT16_MAX + 10UL; i++) {
+        cycle_stats_record(CYCLE_STATS_GENERATE, 5);
+    }
+
+    CHECK(cycle_stats_get(CYCLE_STATS_GENERATE)->histogram[3] == UINT16_MAX);
+    CHECK(cycle_stats_get(CYCLE_STATS_GENERATE)->count == UINT16_MAX + 10UL);
+}
+
+int main(void) {
+    check_min_max_mean();
+    check_bin_edges();
+    check_counter_wrap();
+    check_saturation();
+
+    cycle_stats_log();
+
+    printf("ok\n");
+
+    return 0;
+}
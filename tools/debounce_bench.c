@@ -0,0 +1,304 @@
+/*
+ * Debounce benchmark, runs on the host.
+ * Feeds the same bouncy key streams to matrix_debounce() and to the per key int countdown loop the firmware used
+ * before it, and prints the time per scan of both. With DEBOUNCE_DEFER_PER_KEY the two must agree on every scan.
+ *
+ * Then types on every key with switch waveforms: contact bounce after each press and release, and single scan
+ * glitches while a key rests. Prints the latency the algorithm adds to presses and releases from first contact,
+ * events that match no key transition and transitions that never came out.
+ *
+ * Build and run from the project folder, once for each DEBOUNCE_ALGORITHM:
+ * cc -O2 -DHOST_BUILD -DMASTER -DDEBOUNCE_ALGORITHM=0 -Isrc -o debounce_bench tools/debounce_bench.c \
+ *    src/matrix/matrix_debounce.c
+ * ./debounce_bench [scans] [bounce max in scans] [glitch odds, 0 for none]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "firmware_config.h"
+#include "matrix/matrix_debounce.h"
+
+#define STREAM_SCANS 4096     // Scans of key streams, replayed until the scan count is reached.
+#define SCANS        10000000 // Scans timed for each engine.
+#define BOUNCE_MAX   5        // In scans, contact bounce after each transition.
+#define CHANGE_ODDS  500      // One in this many scans starts a transition on a key that is stable.
+
+// Typing waveforms.
+#define TYPING_SCANS 2000000 // Scans typed.
+#define HOLD_MIN     15      // In scans, key hold time, fast taps are shorter than the release window.
+#define HOLD_MAX     200
+#define REST_MIN     30      // In scans, time between a release and the next press of a key.
+#define REST_MAX     1000
+#define GLITCH_ODDS  20000   // One in this many scans misreads a resting key for one scan.
+
+static const char *ALGORITHM_NAMES[] = {"defer per key", "eager per key", "eager press", "defer per col", "eager per col"};
+
+static uint32_t m_seed = 0x2545F491;
+static uint32_t m_stream[STREAM_SCANS][MATRIX_COL_NUM];
+
+// Per key int countdown loop, debounce of scan_matrix_task before the bit-parallel engine.
+static int m_debounce[MATRIX_ROW_NUM][MATRIX_COL_NUM];
+static bool m_key_pressed[MATRIX_ROW_NUM][MATRIX_COL_NUM];
+
+static uint32_t random_get(uint32_t limit) {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    return m_seed % limit;
+}
+
+// Every key flips at random, reading at random for a few scans after each flip.
+static void stream_build(void) {
+    uint8_t bounce[MATRIX_ROW_NUM][MATRIX_COL_NUM] = {{0}};
+    bool level[MATRIX_ROW_NUM][MATRIX_COL_NUM] = {{false}};
+
+    for (int scan = 0; scan < STREAM_SCANS; scan++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            uint32_t raw = 0;
+
+            for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+                bool read = level[row][col];
+
+                if (bounce[row][col] > 0) {
+                    bounce[row][col]--;
+                    read = random_get(2);
+                } else if (random_get(CHANGE_ODDS) == 0) {
+                    level[row][col] = !level[row][col];
+                    bounce[row][col] = random_get(BOUNCE_MAX + 1);
+                    read = random_get(2);
+                }
+
+                raw |= (uint32_t)read << row;
+            }
+
+            m_stream[scan][col] = raw;
+        }
+    }
+}
+
+static void int_loop_init(void) {
+    for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            m_debounce[row][col] = KEY_PRESS_DEBOUNCE;
+            m_key_pressed[row][col] = false;
+        }
+    }
+}
+
+static bool int_loop_debounce(uint32_t const *p_raw, uint32_t *p_changed) {
+    bool any_changed = false;
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        p_changed[col] = 0;
+
+        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+            bool pressed = (p_raw[col] & (1UL << row)) != 0;
+
+            if (m_key_pressed[row][col] == pressed) {
+                m_debounce[row][col] = pressed ? KEY_RELEASE_DEBOUNCE : KEY_PRESS_DEBOUNCE;
+            } else if (m_debounce[row][col] <= 0) {
+                m_key_pressed[row][col] = pressed;
+                m_debounce[row][col] = pressed ? KEY_RELEASE_DEBOUNCE : KEY_PRESS_DEBOUNCE;
+                p_changed[col] |= 1UL << row;
+                any_changed = true;
+            } else {
+                m_debounce[row][col] -= SCAN_DELAY;
+            }
+        }
+    }
+
+    return any_changed;
+}
+
+typedef struct {
+    bool level;        // Contact state without bounce, changes at first contact.
+    uint16_t bounce;   // Scans of bounce left.
+    uint16_t hold;     // Scans left until the next change.
+    bool pending;      // Level changed and the algorithm did not follow yet.
+    uint32_t since;    // Scan of the pending change.
+} key_wave_t;
+
+typedef struct {
+    uint32_t count[2]; // Release and press latencies, in scans.
+    uint64_t sum[2];
+    uint32_t max[2];
+    uint32_t spurious; // Events that match no pending change.
+    uint32_t missed;   // Pairs of changes over before the algorithm took the first.
+    uint32_t glitches; // Misread scans of resting keys, an eager algorithm takes each as a change and back.
+} wave_stats_t;
+
+// Reading of one key this scan, moves its waveform on. state is the debounced state of the key.
+static bool wave_read(key_wave_t *p_key, bool state, uint32_t scan, uint32_t bounce_max, uint32_t glitch_odds, wave_stats_t *p_stats) {
+    if (p_key->bounce > 0) {
+        p_key->bounce--;
+        return random_get(2);
+    }
+
+    if (--p_key->hold > 0) {
+        if (glitch_odds > 0 && random_get(glitch_odds) == 0) {
+            p_stats->glitches++;
+            return !p_key->level;
+        }
+
+        return p_key->level;
+    }
+
+    p_key->level = !p_key->level;
+    p_key->hold = p_key->level ? HOLD_MIN + random_get(HOLD_MAX - HOLD_MIN + 1) : REST_MIN + random_get(REST_MAX - REST_MIN + 1);
+    p_key->bounce = random_get(bounce_max + 1);
+
+    if (p_key->pending) {
+        // A change before the last one came out loses both, a tap or the gap between two taps.
+        p_key->pending = false;
+        p_stats->missed++;
+    } else if (state != p_key->level) {
+        p_key->pending = true;
+        p_key->since = scan;
+    }
+
+    // First contact reads the new level, bounce follows.
+    return p_key->level;
+}
+
+static void wave_event(key_wave_t *p_key, bool pressed, uint32_t scan, wave_stats_t *p_stats) {
+    if (!p_key->pending || pressed != p_key->level) {
+        p_stats->spurious++;
+        return;
+    }
+
+    uint32_t latency = scan - p_key->since;
+
+    p_key->pending = false;
+    p_stats->count[pressed]++;
+    p_stats->sum[pressed] += latency;
+
+    if (latency > p_stats->max[pressed]) {
+        p_stats->max[pressed] = latency;
+    }
+}
+
+static void typing_run(uint32_t bounce_max, uint32_t glitch_odds) {
+    static key_wave_t keys[MATRIX_ROW_NUM][MATRIX_COL_NUM];
+    uint32_t raw[MATRIX_COL_NUM];
+    uint32_t state[MATRIX_COL_NUM] = {0};
+    uint32_t changed[MATRIX_COL_NUM];
+    wave_stats_t stats = {0};
+
+    memset(keys, 0, sizeof(keys));
+    matrix_debounce_init();
+
+    for (int col = 0; col < MATRIX_COL_NUM; col++) {
+        for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+            keys[row][col].hold = 1 + random_get(REST_MAX);
+        }
+    }
+
+    for (uint32_t scan = 0; scan < TYPING_SCANS; scan++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            raw[col] = 0;
+
+            for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+                raw[col] |= (uint32_t)wave_read(&keys[row][col], (state[col] & (1UL << row)) != 0, scan, bounce_max, glitch_odds, &stats) << row;
+            }
+        }
+
+        matrix_debounce(raw, state, changed);
+
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+                if (changed[col] & (1UL << row)) {
+                    wave_event(&keys[row][col], (state[col] & (1UL << row)) != 0, scan, &stats);
+                }
+            }
+        }
+    }
+
+    printf("Typing, bounce up to %u scans, glitch odds 1/%u, 0 for none. Latency in ms.\n", bounce_max, glitch_odds);
+    printf("press mean  max  release mean  max  spurious  missed  glitches\n");
+    printf("     %5.2f %4u          %5.2f %4u  %8u  %6u  %8u\n", stats.count[1] ? (double)stats.sum[1] / stats.count[1] * SCAN_DELAY : 0.0,
+           stats.max[1] * SCAN_DELAY, stats.count[0] ? (double)stats.sum[0] / stats.count[0] * SCAN_DELAY : 0.0,
+           stats.max[0] * SCAN_DELAY, stats.spurious, stats.missed, stats.glitches);
+}
+
+static double seconds_get(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// With the algorithm the int loop implements, both must change the same keys on every scan.
+static bool equivalence_check(void) {
+    uint32_t state[MATRIX_COL_NUM] = {0};
+    uint32_t changed[MATRIX_COL_NUM];
+    uint32_t loop_changed[MATRIX_COL_NUM];
+
+    matrix_debounce_init();
+    int_loop_init();
+
+    for (int scan = 0; scan < 16 * STREAM_SCANS; scan++) {
+        uint32_t const *p_raw = m_stream[scan % STREAM_SCANS];
+
+        matrix_debounce(p_raw, state, changed);
+        int_loop_debounce(p_raw, loop_changed);
+
+        if (memcmp(changed, loop_changed, sizeof(changed)) != 0) {
+            printf("Engines differ at scan %i.\n", scan);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t scans = argc > 1 ? strtoul(argv[1], NULL, 10) : SCANS;
+    uint32_t bounce_max = argc > 2 ? strtoul(argv[2], NULL, 10) : BOUNCE_MAX;
+    uint32_t glitch_odds = argc > 3 ? strtoul(argv[3], NULL, 10) : GLITCH_ODDS;
+    uint32_t state[MATRIX_COL_NUM] = {0};
+    uint32_t changed[MATRIX_COL_NUM];
+    uint32_t changes = 0;
+    uint32_t loop_changes = 0;
+
+    stream_build();
+
+    if (DEBOUNCE_ALGORITHM == DEBOUNCE_DEFER_PER_KEY && !equivalence_check()) {
+        return 1;
+    }
+
+    matrix_debounce_init();
+
+    double start = seconds_get();
+
+    for (uint32_t scan = 0; scan < scans; scan++) {
+        changes += matrix_debounce(m_stream[scan % STREAM_SCANS], state, changed);
+    }
+
+    double engine_ns = (seconds_get() - start) * 1e9 / scans;
+
+    int_loop_init();
+    start = seconds_get();
+
+    for (uint32_t scan = 0; scan < scans; scan++) {
+        loop_changes += int_loop_debounce(m_stream[scan % STREAM_SCANS], changed);
+    }
+
+    double loop_ns = (seconds_get() - start) * 1e9 / scans;
+
+    printf("%ix%i matrix, %s, windows %i/%i scans.\n", MATRIX_ROW_NUM, MATRIX_COL_NUM, ALGORITHM_NAMES[DEBOUNCE_ALGORITHM],
+           KEY_PRESS_DEBOUNCE / SCAN_DELAY, KEY_RELEASE_DEBOUNCE / SCAN_DELAY);
+    printf("engine    ns/scan  changed scans\n");
+    printf("bit-par   %7.1f  %u\n", engine_ns, changes);
+    printf("int loop  %7.1f  %u\n", loop_ns, loop_changes);
+
+    typing_run(bounce_max, glitch_odds);
+
+    return 0;
+}
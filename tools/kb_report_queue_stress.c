@@ -0,0 +1,301 @@
+/*
+ * Keyboard report queue stress test, runs on the host.
+ * Types random keys and modifiers into the queue the way main_master does, one report per change. Reports the queue
+ * has no room for wait in the pending reports until it is empty. The SoftDevice refuses notifications for a block of
+ * connection events, then takes a few reports on each event for a while before the next block.
+ *
+ * The host must see every press in the order it was typed, with the modifiers held at the time, one new key per
+ * report at most, and end with the keys held as typed, for every block length.
+ *
+ * Build and run from the project folder:
+ * cc -O2 -DHOST_BUILD -DMASTER -Isrc -o kb_report_queue_stress tools/kb_report_queue_stress.c \
+ *    src/kb_report_queue/kb_report_queue.c src/pending_report/pending_report.c
+ * ./kb_report_queue_stress [events]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kb_report_queue/kb_report_queue.h"
+#include "pending_report/pending_report.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define EVENTS         20000 // Connection events typed for each block length and mode.
+#define EVENT_INTERVAL 7.5   // In ms, connection interval.
+#define CHANGE_ODDS    4     // One in this many events changes a key, 33 changes per second.
+#define MODIFIER_ODDS  4     // One in this many changes is a modifier.
+#define KEY_RANGE      40    // Keys typed, usages 0x04 onwards.
+#define EVENT_SLOTS    3     // Notifications the SoftDevice takes on each event it is not refusing.
+#define SEND_EVENTS    200   // Events the SoftDevice takes notifications on after each block.
+#define PRESS_LOG_SIZE 16384
+
+static const uint16_t BLOCKS[] = {0, 1, 4, 16, 64, 200, 400}; // Events refused in a row.
+
+typedef struct {
+    uint8_t usage;
+    uint8_t modifiers; // Held as the key went down.
+} press_t;
+
+static uint32_t m_seed = 0x2545F491;
+
+static kb_report_queue_t m_queue;
+static bool m_nkro;
+
+static uint8_t m_typed[KB_STATE_LEN]; // Keys as typed.
+static uint8_t m_host[KB_STATE_LEN];  // Keys as the host has them.
+static press_t m_typed_presses[PRESS_LOG_SIZE];
+static press_t m_host_presses[PRESS_LOG_SIZE];
+static uint32_t m_typed_count;
+static uint32_t m_host_count;
+static uint32_t m_reports;
+
+static uint32_t random_get(uint32_t limit) {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    return m_seed % limit;
+}
+
+static bool bit_get(uint8_t const *p_state, uint8_t usage) {
+    return p_state[usage / 8] & (1U << (usage % 8));
+}
+
+static uint8_t modifiers_get(uint8_t const *p_state) {
+    return p_state[0xE0 / 8];
+}
+
+static void report_from_state(uint8_t const *p_state, hid_report_t *p_report) {
+    memset(p_report, 0, sizeof(hid_report_t));
+
+    if (m_nkro) {
+        p_report->type = HID_TYPE_NKRO_REPORT;
+        p_report->data.nkro[0] = modifiers_get(p_state);
+        memcpy(&p_report->data.nkro[1], p_state, NKRO_BITMAP_LEN);
+        return;
+    }
+
+    p_report->type = HID_TYPE_KB_REPORT;
+    p_report->data.kb[0] = modifiers_get(p_state);
+
+    for (int usage = 1, i = 2; usage < 0xE0 && i < KB_INPUT_REPORT_MAX_LEN; usage++) {
+        if (bit_get(p_state, usage)) {
+            p_report->data.kb[i++] = usage;
+        }
+    }
+}
+
+static void state_from_report(uint8_t const *p_report, uint8_t *p_state) {
+    memset(p_state, 0, KB_STATE_LEN);
+
+    if (m_nkro) {
+        memcpy(p_state, &p_report[1], NKRO_BITMAP_LEN);
+    } else {
+        for (int i = 2; i < KB_INPUT_REPORT_MAX_LEN; i++) {
+            if (p_report[i] != 0) {
+                p_state[p_report[i] / 8] |= 1U << (p_report[i] % 8);
+            }
+        }
+    }
+
+    p_state[0xE0 / 8] = p_report[0];
+}
+
+// As hids_send_report() puts a report with the link up: behind pending ones, and pending if the queue has no room.
+static void report_put(hid_report_t const *p_report) {
+    if (pending_report_count() > 0 || !kb_report_queue_put(&m_queue, p_report->data.kb)) {
+        pending_report_hold(p_report);
+    }
+}
+
+// As pending_reports_pump(), pending reports go into the queue only while it is empty.
+static void pending_pump(void) {
+    hid_report_t const *p_pending;
+
+    while ((p_pending = pending_report_peek()) != NULL && kb_report_queue_is_empty(&m_queue)) {
+        CHECK(kb_report_queue_put(&m_queue, p_pending->data.kb));
+        pending_report_pop();
+    }
+}
+
+static void host_apply(uint8_t const *p_report) {
+    uint8_t state[KB_STATE_LEN];
+    int new_keys = 0;
+
+    state_from_report(p_report, state);
+
+    for (int usage = 1; usage < 0xE0; usage++) {
+        if (bit_get(state, usage) && !bit_get(m_host, usage)) {
+            CHECK(m_host_count < PRESS_LOG_SIZE);
+            m_host_presses[m_host_count].usage = usage;
+            m_host_presses[m_host_count].modifiers = modifiers_get(state);
+            m_host_count++;
+            new_keys++;
+        }
+    }
+
+    CHECK(new_keys <= 1);
+
+    memcpy(m_host, state, KB_STATE_LEN);
+    m_reports++;
+}
+
+// Notifications the SoftDevice takes on one event.
+static void event_send(int slots) {
+    uint8_t report[NKRO_INPUT_REPORT_MAX_LEN];
+
+    for (int i = 0; i < slots; i++) {
+        pending_pump();
+
+        if (!kb_report_queue_peek(&m_queue, report)) {
+            return;
+        }
+
+        host_apply(report);
+        kb_report_queue_pop(&m_queue);
+    }
+}
+
+static void key_change(void) {
+    hid_report_t report;
+    uint8_t usage = random_get(MODIFIER_ODDS) == 0 ? 0xE0 + random_get(8) : 0x04 + random_get(KEY_RANGE);
+    uint8_t held_keys[KEY_RANGE];
+    int held = 0;
+
+    for (int key = 0x04; key < 0x04 + KEY_RANGE; key++) {
+        if (bit_get(m_typed, key)) {
+            held_keys[held++] = key;
+        }
+    }
+
+    // Keys are let go soon, a few are held at once.
+    if (usage < 0xE0 && held > 0 && random_get(2) == 0) {
+        usage = held_keys[random_get(held)];
+    }
+
+    bool down = bit_get(m_typed, usage);
+
+    // A 6 key report has no room for a seventh key.
+    if (!down && !m_nkro && usage < 0xE0 && held == KB_INPUT_REPORT_MAX_LEN - 2) {
+        return;
+    }
+
+    m_typed[usage / 8] ^= 1U << (usage % 8);
+
+    if (!down && usage < 0xE0) {
+        CHECK(m_typed_count < PRESS_LOG_SIZE);
+        m_typed_presses[m_typed_count].usage = usage;
+        m_typed_presses[m_typed_count].modifiers = modifiers_get(m_typed);
+        m_typed_count++;
+    }
+
+    report_from_state(m_typed, &report);
+    report_put(&report);
+}
+
+// Host presses must be the typed ones in order with their modifiers. Empties the logs.
+static void presses_check(void) {
+    CHECK(m_host_count == m_typed_count);
+    CHECK(memcmp(m_host_presses, m_typed_presses, m_typed_count * sizeof(press_t)) == 0);
+
+    m_typed_count = 0;
+    m_host_count = 0;
+}
+
+static void run(bool nkro, uint16_t block, uint32_t events) {
+    uint32_t typed = 0;
+    uint32_t pending_max = 0;
+
+    m_nkro = nkro;
+    kb_report_queue_init(&m_queue, nkro);
+    pending_report_init();
+    memset(m_typed, 0, sizeof(m_typed));
+    memset(m_host, 0, sizeof(m_host));
+    m_reports = 0;
+
+    for (uint32_t event = 0; event < events; event++) {
+        if (random_get(CHANGE_ODDS) == 0) {
+            key_change();
+        }
+
+        if (pending_report_count() > pending_max) {
+            pending_max = pending_report_count();
+        }
+
+        if (event % (block + SEND_EVENTS) >= block) {
+            event_send(EVENT_SLOTS);
+        }
+
+        // Compare the logs before they fill.
+        if (m_typed_count > PRESS_LOG_SIZE / 2 && pending_report_count() == 0 && kb_report_queue_is_empty(&m_queue)) {
+            typed += m_typed_count;
+            presses_check();
+        }
+    }
+
+    while (pending_report_count() > 0 || !kb_report_queue_is_empty(&m_queue)) {
+        event_send(EVENT_SLOTS);
+    }
+
+    CHECK(memcmp(m_host, m_typed, KB_STATE_LEN) == 0);
+
+    typed += m_typed_count;
+    presses_check();
+
+    printf("%-5s %5u  %7u  %7u  %11u\n", nkro ? "nkro" : "6 key", block, typed, m_reports, pending_max);
+}
+
+// Keys of one NKRO report going down together fill more than the queue, an empty queue takes them anyway.
+static void check_flood(void) {
+    hid_report_t report;
+    uint8_t report_out[NKRO_INPUT_REPORT_MAX_LEN];
+
+    m_nkro = true;
+    kb_report_queue_init(&m_queue, true);
+    memset(m_typed, 0, sizeof(m_typed));
+    memset(m_host, 0, sizeof(m_host));
+
+    for (int usage = 0x04; usage < 0x04 + KB_REPORT_QUEUE_SIZE + 8; usage++) {
+        m_typed[usage / 8] |= 1U << (usage % 8);
+    }
+
+    report_from_state(m_typed, &report);
+    CHECK(kb_report_queue_put(&m_queue, report.data.kb));
+
+    while (kb_report_queue_peek(&m_queue, report_out)) {
+        state_from_report(report_out, m_host);
+        kb_report_queue_pop(&m_queue);
+    }
+
+    CHECK(memcmp(m_host, m_typed, KB_STATE_LEN) == 0);
+}
+
+int main(int argc, char **argv) {
+    uint32_t events = argc > 1 ? strtoul(argv[1], NULL, 10) : EVENTS;
+
+    check_flood();
+
+    printf("Typing %.0f changes per second, blocks of refused events of %.1f ms.\n",
+           1000 / (CHANGE_ODDS * EVENT_INTERVAL), EVENT_INTERVAL);
+    printf("mode  block  presses  reports  pending max\n");
+
+    for (int nkro = 0; nkro < 2; nkro++) {
+        for (size_t i = 0; i < sizeof(BLOCKS) / sizeof(BLOCKS[0]); i++) {
+            run(nkro, BLOCKS[i], events);
+        }
+    }
+
+    printf("ok\n");
+
+    return 0;
+}
@@ -0,0 +1,295 @@
+/*
+ * Key set benchmark, runs on the host.
+ * Holds 1 to 20 keys while one key changes on every event, and times three ways of keeping the pressed keys:
+ * - the update_key_index() loop the master ran before key sets, rebuilding its key list from the active list,
+ * - a key set updated by each event, as key_event_handler() does,
+ * - a key set built from the whole list and diffed against the last one, as update_slave_key_index() does.
+ * Checks that all three hold the same keys after every event, and prints the time per event of each.
+ *
+ * Build and run from the project folder:
+ * cc -O2 -DHOST_BUILD -DMASTER -Isrc -o key_set_bench tools/key_set_bench.c src/key_event/key_event.c
+ * ./key_set_bench [events]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "key_event/key_event.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define EVENTS      2000000 // Key events for each held count.
+#define STREAM_SIZE 65536   // Events of the stream, replayed until the event count is reached.
+#define HELD_MAX    KEY_NUM // Keys the old loop could hold.
+
+// Old key list entry, the fields update_key_index() used.
+typedef struct {
+    int8_t index;
+    uint8_t source;
+    bool should_delete;
+} old_key_t;
+
+// Keys held in the order they went down, as the active key lists pass them. Both halves together hold up to KEY_NUM.
+typedef struct {
+    int8_t key_index[HELD_MAX];
+    uint8_t count;
+} list_t;
+
+static uint32_t m_seed = 0x2545F491;
+
+static key_event_t m_stream[STREAM_SIZE];
+
+static old_key_t m_old_keys[KEY_NUM];
+static int m_old_key_count;
+static volatile uint32_t m_sink;
+
+static uint32_t random_get(uint32_t limit) {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    return m_seed % limit;
+}
+
+static double seconds_get(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Presses a new key while fewer than held are down, else releases one of them. The stream ends with every key up.
+static void stream_build(int held) {
+    key_set_t down = {0};
+    int8_t down_keys[HELD_MAX];
+    int count = 0;
+
+    for (int i = 0; i < STREAM_SIZE; i++) {
+        key_event_t *p_event = &m_stream[i];
+        bool release = count == held || (count > 0 && random_get(2) == 0);
+
+        if (i >= STREAM_SIZE - HELD_MAX) {
+            release = count > 0;
+        }
+
+        if (release) {
+            int slot = random_get(count);
+
+            p_event->key_index = down_keys[slot];
+            p_event->pressed = false;
+            down_keys[slot] = down_keys[--count];
+            key_set_remove(&down, p_event->key_index);
+            continue;
+        }
+
+        // Every key is up for the rest of the stream, a release of a key that is not down changes nothing.
+        if (i >= STREAM_SIZE - HELD_MAX) {
+            p_event->key_index = 1;
+            p_event->pressed = false;
+            continue;
+        }
+
+        do {
+            p_event->key_index = 1 + random_get(KEY_INDEX_MAX);
+        } while (key_set_has(&down, p_event->key_index));
+
+        p_event->pressed = true;
+        down_keys[count++] = p_event->key_index;
+        key_set_add(&down, p_event->key_index);
+    }
+
+    CHECK(count == 0);
+}
+
+// update_key_index() as the master ran it before key sets, O(n^2) in held keys.
+static void old_update_key_index(int8_t const *p_key_index, uint16_t size, uint8_t source) {
+    for (int i = 0; i < m_old_key_count; i++) {
+        if (m_old_keys[i].source == source) {
+            m_old_keys[i].should_delete = true;
+        }
+    }
+
+    for (int i = 0; i < size; i++) {
+        int j = 0;
+
+        while (j < m_old_key_count && m_old_keys[j].index != p_key_index[i]) {
+            j++;
+        }
+
+        if (j < m_old_key_count) {
+            m_old_keys[j].should_delete = false;
+        } else if (m_old_key_count < KEY_NUM) {
+            old_key_t key = {0};
+
+            key.index = p_key_index[i];
+            key.source = source;
+            m_old_keys[m_old_key_count++] = key;
+        }
+    }
+
+    int i = 0;
+
+    while (i < m_old_key_count) {
+        while (i < m_old_key_count && !m_old_keys[i].should_delete) {
+            i++;
+        }
+
+        if (i < m_old_key_count) {
+            for (int j = i; j < m_old_key_count - 1; j++) {
+                m_old_keys[j] = m_old_keys[j + 1];
+            }
+
+            m_old_key_count--;
+        }
+    }
+}
+
+static void list_apply(list_t *p_list, key_event_t const *p_event) {
+    if (p_event->pressed) {
+        p_list->key_index[p_list->count++] = p_event->key_index;
+        return;
+    }
+
+    for (int i = 0; i < p_list->count; i++) {
+        if (p_list->key_index[i] == p_event->key_index) {
+            p_list->key_index[i] = p_list->key_index[--p_list->count];
+            return;
+        }
+    }
+}
+
+static void old_event(list_t *p_list, key_event_t const *p_event) {
+    list_apply(p_list, p_event);
+    old_update_key_index(p_list->key_index, p_list->count, 0);
+}
+
+static void set_event(key_set_t *p_set, key_event_t const *p_event) {
+    if (p_event->pressed) {
+        key_set_add(p_set, p_event->key_index);
+    } else {
+        key_set_remove(p_set, p_event->key_index);
+    }
+}
+
+static void list_event(list_t *p_list, key_set_t *p_last, key_event_t const *p_event) {
+    key_set_t pressed;
+    key_set_t released;
+    key_set_t new_pressed;
+    int8_t key_index;
+
+    list_apply(p_list, p_event);
+    key_set_from_list(&pressed, p_list->key_index, p_list->count);
+    key_set_diff(p_last, &pressed, &released, &new_pressed);
+
+    while ((key_index = key_set_pop(&released)) >= 0) {
+        m_sink += key_index;
+    }
+
+    while ((key_index = key_set_pop(&new_pressed)) >= 0) {
+        m_sink += key_index;
+    }
+
+    *p_last = pressed;
+}
+
+// All three hold the same keys after every event of the stream.
+static void check_same_keys(void) {
+    list_t old_list = {0};
+    list_t list = {0};
+    key_set_t set = {0};
+    key_set_t last = {0};
+
+    m_old_key_count = 0;
+
+    for (int i = 0; i < STREAM_SIZE; i++) {
+        key_set_t old_set = {0};
+
+        old_event(&old_list, &m_stream[i]);
+        set_event(&set, &m_stream[i]);
+        list_event(&list, &last, &m_stream[i]);
+
+        for (int key = 0; key < m_old_key_count; key++) {
+            key_set_add(&old_set, m_old_keys[key].index);
+        }
+
+        CHECK(memcmp(&old_set, &set, sizeof(key_set_t)) == 0);
+        CHECK(memcmp(&last, &set, sizeof(key_set_t)) == 0);
+    }
+}
+
+static void check_set(void) {
+    key_set_t set = {0};
+    int8_t list[] = {0, 1, 31, 32, 33, KEY_INDEX_MAX, KEY_INDEX_MAX + 1, -3};
+
+    key_set_from_list(&set, list, sizeof(list));
+
+    CHECK(!key_set_has(&set, 0));
+    CHECK(key_set_pop(&set) == 1);
+    CHECK(key_set_pop(&set) == 31);
+    CHECK(key_set_pop(&set) == 32);
+    CHECK(key_set_pop(&set) == 33);
+    CHECK(key_set_pop(&set) == KEY_INDEX_MAX);
+    CHECK(key_set_pop(&set) == -1);
+}
+
+int main(int argc, char **argv) {
+    uint32_t events = argc > 1 ? strtoul(argv[1], NULL, 10) : EVENTS;
+
+    check_set();
+
+    printf("ns/event  held  old loop  key set  list diff\n");
+
+    for (int held = 1; held <= HELD_MAX; held++) {
+        list_t list = {0};
+        key_set_t set = {0};
+        key_set_t last = {0};
+
+        stream_build(held);
+        check_same_keys();
+
+        m_old_key_count = 0;
+
+        double start = seconds_get();
+
+        for (uint32_t i = 0; i < events; i++) {
+            old_event(&list, &m_stream[i % STREAM_SIZE]);
+        }
+
+        double old_ns = (seconds_get() - start) * 1e9 / events;
+
+        start = seconds_get();
+
+        for (uint32_t i = 0; i < events; i++) {
+            set_event(&set, &m_stream[i % STREAM_SIZE]);
+            m_sink += set.words[0];
+        }
+
+        double set_ns = (seconds_get() - start) * 1e9 / events;
+
+        list.count = 0;
+        start = seconds_get();
+
+        for (uint32_t i = 0; i < events; i++) {
+            list_event(&list, &last, &m_stream[i % STREAM_SIZE]);
+        }
+
+        double list_ns = (seconds_get() - start) * 1e9 / events;
+
+        printf("          %4i  %8.1f  %7.1f  %9.1f\n", held, old_ns, set_ns, list_ns);
+    }
+
+    printf("ok\n");
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Keymap resolver, runs on the host.
+ * Resolves every KC_TRANSPARENT of KEYMAP to the first lower layer that defines the key, then writes a header with
+ * the codes. Layers are split into chunks of MATRIX_COL_NUM keys and identical chunks are stored once.
+ *
+ * Build and run from the project folder after any change of keymap.h:
+ * cc -I src/config -o keymap_resolve tools/keymap_resolve.c
+ * ./keymap_resolve > src/config/keymap_resolved.h
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "keymap.h"
+
+#define KEY_INDEX_NUM (MATRIX_COL_NUM * MATRIX_ROW_NUM * 2)
+#define LAYER_NUM     (sizeof(KEYMAP) / sizeof(KEYMAP[0]))
+#define CHUNK_LEN     MATRIX_COL_NUM
+#define CHUNK_NUM     (KEY_INDEX_NUM / CHUNK_LEN)
+
+static uint32_t m_resolved[LAYER_NUM][KEY_INDEX_NUM];
+static uint32_t m_chunks[LAYER_NUM * CHUNK_NUM][CHUNK_LEN];
+static int m_chunk_count = 0;
+static int m_layer_chunks[LAYER_NUM][CHUNK_NUM];
+
+static int chunk_find(uint32_t const *p_chunk) {
+    for (int i = 0; i < m_chunk_count; i++) {
+        if (memcmp(m_chunks[i], p_chunk, sizeof(m_chunks[i])) == 0) {
+            return i;
+        }
+    }
+
+    memcpy(m_chunks[m_chunk_count], p_chunk, sizeof(m_chunks[0]));
+
+    return m_chunk_count++;
+}
+
+int main(void) {
+    for (int layer = 0; layer < (int)LAYER_NUM; layer++) {
+        for (int index = 0; index < KEY_INDEX_NUM; index++) {
+            int from = layer;
+
+            while (from > 0 && KEYMAP[from][index] == KC_TRANSPARENT) {
+                from--;
+            }
+
+            uint32_t code = KEYMAP[from][index];
+
+            // Transparent down to base layer does nothing.
+            if (code == KC_TRANSPARENT) {
+                code = KC_NO;
+            }
+
+            m_resolved[layer][index] = code;
+        }
+
+        for (int chunk = 0; chunk < CHUNK_NUM; chunk++) {
+            m_layer_chunks[layer][chunk] = chunk_find(&m_resolved[layer][chunk * CHUNK_LEN]);
+        }
+    }
+
+    if (m_chunk_count > UINT8_MAX) {
+        fprintf(stderr, "Too many chunks.\n");
+        return 1;
+    }
+
+    printf("#ifndef _KEYMAP_RESOLVED_H_\n");
+    printf("#define _KEYMAP_RESOLVED_H_\n\n");
+    printf("// Generated by tools/keymap_resolve.c from keymap.h, do not edit.\n\n");
+    printf("#include <stdint.h>\n\n");
+    printf("#include \"../keycodes.h\"\n");
+    printf("#include \"keyboard.h\"\n\n");
+    printf("#define KEYMAP_LAYER_NUM %d\n\n", (int)LAYER_NUM);
+
+    printf("// Resolved key codes in chunks of MATRIX_COL_NUM keys, identical chunks are stored once.\n");
+    printf("const uint32_t KEYMAP_CHUNKS[][MATRIX_COL_NUM] = {\n");
+
+    for (int i = 0; i < m_chunk_count; i++) {
+        printf("    {");
+
+        for (int j = 0; j < CHUNK_LEN; j++) {
+            printf("0x%04X%s", m_chunks[i][j], j < CHUNK_LEN - 1 ? ", " : "");
+        }
+
+        printf("}%s\n", i < m_chunk_count - 1 ? "," : "");
+    }
+
+    printf("};\n\n");
+
+    printf("// Chunk of every part of each layer.\n");
+    printf("const uint8_t KEYMAP_LAYER_CHUNKS[KEYMAP_LAYER_NUM][MATRIX_ROW_NUM * 2] = {\n");
+
+    for (int layer = 0; layer < (int)LAYER_NUM; layer++) {
+        printf("    {");
+
+        for (int chunk = 0; chunk < CHUNK_NUM; chunk++) {
+            printf("%d%s", m_layer_chunks[layer][chunk], chunk < CHUNK_NUM - 1 ? ", " : "");
+        }
+
+        printf("}%s\n", layer < (int)LAYER_NUM - 1 ? "," : "");
+    }
+
+    printf("};\n\n");
+
+    printf("// Resolved code of a key index, counted from 0. Layers that are not defined have no keys.\n");
+    printf("static inline uint32_t keymap_code_get(uint8_t layer, uint8_t index) {\n");
+    printf("    if (layer >= KEYMAP_LAYER_NUM) {\n");
+    printf("        return 0;\n");
+    printf("    }\n\n");
+    printf("    return KEYMAP_CHUNKS[KEYMAP_LAYER_CHUNKS[layer][index / MATRIX_COL_NUM]][index %% MATRIX_COL_NUM];\n");
+    printf("}\n\n");
+    printf("#endif\n");
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Layer state checks, runs on the host.
+ * Layer keys are pressed and released by hand, the highest active layer is checked after each change.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o layer_state_check tools/layer_state_check.c src/layer_state/layer_state.c
+ * ./layer_state_check
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "keycodes.h"
+#include "layer_state/layer_state.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define MO(layer) (KC_LAYER_BASE + (layer))
+#define TG(layer) (KC_LAYER_TOGGLE_BASE + (layer))
+
+// Two keys holding the same layer keep it on until the last one is let go.
+static void check_two_holders(void) {
+    layer_state_init();
+
+    CHECK(layer_state_key(MO(1), true));
+    CHECK(layer_state_key(MO(1), true));
+    CHECK(layer_state_highest() == 1);
+
+    CHECK(layer_state_key(MO(1), false));
+    CHECK(layer_state_highest() == 1);
+
+    CHECK(layer_state_key(MO(1), false));
+    CHECK(layer_state_highest() == _BASE_LAYER);
+}
+
+// A release with no press before it, as after a reset while the key was down, leaves no count behind.
+static void check_stray_release(void) {
+    layer_state_init();
+
+    CHECK(layer_state_key(MO(2), false));
+    CHECK(layer_state_key(MO(2), true));
+    CHECK(layer_state_highest() == 2);
+
+    CHECK(layer_state_key(MO(2), false));
+    CHECK(layer_state_highest() == _BASE_LAYER);
+}
+
+// Holders of different layers and a toggled layer do not end each other.
+static void check_layers_apart(void) {
+    layer_state_init();
+
+    CHECK(layer_state_key(TG(1), true));
+    CHECK(layer_state_key(TG(1), false));
+    CHECK(layer_state_key(MO(3), true));
+    CHECK(layer_state_key(MO(2), true));
+    CHECK(layer_state_highest() == 3);
+
+    CHECK(layer_state_key(MO(3), false));
+    CHECK(layer_state_highest() == 2);
+
+    CHECK(layer_state_key(MO(2), false));
+    CHECK(layer_state_highest() == 1);
+
+    CHECK(!layer_state_key(KC_A, true));
+}
+
+int main(void) {
+    check_two_holders();
+    check_stray_release();
+    check_layers_apart();
+
+    printf("ok\n");
+
+    return 0;
+}
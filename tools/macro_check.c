@@ -0,0 +1,103 @@
+/*
+ * Macro player checks, runs on the host.
+ * Plays byte code strings and checks every report: text taps, shifted text, held modifiers, and bytes with no
+ * keycode, which are skipped while the rest of the macro plays.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o macro_check tools/macro_check.c src/macro/macro.c
+ * ./macro_check
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "keycodes.h"
+#include "macro/macro.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+// Next report must hold modifiers and key in the first slot, key 0 for none.
+static void expect(uint8_t modifiers, uint8_t key) {
+    uint8_t report[MACRO_REPORT_LEN];
+
+    CHECK(macro_next(report));
+    CHECK(report[0] == modifiers);
+    CHECK(report[2] == key);
+
+    for (int i = 3; i < MACRO_REPORT_LEN; i++) {
+        CHECK(report[i] == 0);
+    }
+}
+
+static void expect_end(void) {
+    uint8_t report[MACRO_REPORT_LEN];
+
+    CHECK(!macro_next(report));
+    CHECK(!macro_is_playing());
+}
+
+static void check_text(void) {
+    static const uint8_t MACRO[] = "aB\n";
+
+    macro_start(MACRO);
+
+    expect(0, KC_A);
+    expect(0, 0);
+    expect(MOD_BIT(KC_LSHIFT), KC_B);
+    expect(0, 0);
+    expect(0, KC_ENTER);
+    expect(0, 0);
+    expect_end();
+}
+
+// Modifiers held by MACRO_MODS are let go before the macro ends.
+static void check_mods(void) {
+    static const uint8_t MACRO[] = {MACRO_MODS, MOD_BIT(KC_LCTRL), MACRO_TAP, KC_C, MACRO_END};
+
+    macro_start(MACRO);
+
+    expect(MOD_BIT(KC_LCTRL), 0);
+    expect(MOD_BIT(KC_LCTRL), KC_C);
+    expect(MOD_BIT(KC_LCTRL), 0);
+    expect(0, 0);
+    expect_end();
+}
+
+// A byte with no keycode, here UTF-8 and control bytes, is skipped. Only MACRO_END ends the macro.
+static void check_unmapped(void) {
+    static const uint8_t MACRO[] = "a\xC3\xA9\x7F\x05" "b";
+
+    macro_start(MACRO);
+
+    expect(0, KC_A);
+    expect(0, 0);
+    expect(0, KC_B);
+    expect(0, 0);
+    expect_end();
+}
+
+// Bytes with no keycode at the end leave nothing to play.
+static void check_unmapped_end(void) {
+    static const uint8_t MACRO[] = "\x80\x81";
+
+    macro_start(MACRO);
+    expect_end();
+}
+
+int main(void) {
+    check_text();
+    check_mods();
+    check_unmapped();
+    check_unmapped_end();
+
+    printf("ok\n");
+
+    return 0;
+}
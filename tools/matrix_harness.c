@@ -0,0 +1,289 @@
+/*
+ * Matrix engine checks, runs on the host.
+ * The engine runs on a fake strobe backend: keys are set in a fake matrix, the driven column reads its pressed rows
+ * and settle_start only marks the settle timer armed, so the harness decides when a column has settled. Checks the
+ * strobe pass, debounce windows, key event order and time stamps, and idle and settled states.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o matrix_harness tools/matrix_harness.c src/matrix/matrix.c \
+ *    src/matrix/matrix_strobe.c src/matrix/matrix_debounce.c src/matrix/matrix_ghost.c src/key_event/key_event.c
+ * ./matrix_harness
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix/matrix.h"
+#include "firmware_config.h"
+#include "key_event/key_event.h"
+
+#define PRESS_SCANS   (KEY_PRESS_DEBOUNCE / SCAN_DELAY)
+#define RELEASE_SCANS (KEY_RELEASE_DEBOUNCE / SCAN_DELAY)
+
+// Bounce after first contact the algorithm sits out, eager ones only ignore the key for their lockout.
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PER_KEY || DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER_PER_COLUMN
+#define BOUNCE_SCANS (KEY_EAGER_DEBOUNCE / SCAN_DELAY)
+#else
+#define BOUNCE_SCANS PRESS_SCANS
+#endif
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+const int8_t MATRIX[MATRIX_ROW_NUM][MATRIX_COL_NUM] = MATRIX_DEFINE;
+
+static uint32_t m_keys[MATRIX_COL_NUM]; // Fake matrix, pressed rows of each column.
+static int m_driven = -1;               // Column driven high, -1 if none.
+static int m_driven_count;              // Columns driven at once, must never go over one.
+static bool m_settle_armed;
+static bool m_pass_done;
+static uint32_t m_now;
+static int m_keys_changed;
+
+static void fake_col_set(uint8_t col) {
+    CHECK(m_driven == -1);
+
+    m_driven = col;
+    m_driven_count++;
+}
+
+static void fake_col_clear(uint8_t col) {
+    CHECK(m_driven == col);
+
+    m_driven = -1;
+    m_driven_count--;
+}
+
+static uint32_t fake_rows_read(void) {
+    CHECK(m_driven >= 0 && m_driven_count == 1);
+    CHECK(!m_settle_armed);
+
+    return m_keys[m_driven];
+}
+
+static void fake_settle_start(void) {
+    CHECK(!m_settle_armed);
+
+    m_settle_armed = true;
+}
+
+static const matrix_strobe_backend_t FAKE_BACKEND = {
+    .init = NULL,
+    .col_set = fake_col_set,
+    .col_clear = fake_col_clear,
+    .rows_read = fake_rows_read,
+    .settle_start = fake_settle_start
+};
+
+static void pass_done_handler(void) {
+    m_pass_done = true;
+}
+
+static void evt_handler(matrix_evt_t const *p_evt) {
+    CHECK(p_evt->type == MATRIX_EVT_KEYS_CHANGED);
+
+    m_keys_changed++;
+}
+
+static uint32_t timestamp_get(void) {
+    return m_now;
+}
+
+// One scan period: a full strobe pass, one settle timer expiry per column, then the debounce step.
+static bool scan(void) {
+    int settles = 0;
+
+    m_pass_done = false;
+    CHECK(matrix_scan_start());
+    CHECK(!matrix_scan_start()); // A pass in progress is not restarted.
+
+    while (m_settle_armed) {
+        m_settle_armed = false;
+        settles++;
+        matrix_strobe_settled();
+    }
+
+    CHECK(settles == MATRIX_COL_NUM);
+    CHECK(m_pass_done && m_driven == -1);
+
+    bool changed = matrix_scan_step();
+
+    m_now++;
+
+    return changed;
+}
+
+static void key_set(int8_t key_index, bool pressed) {
+    for (int row = 0; row < MATRIX_ROW_NUM; row++) {
+        for (int col = 0; col < MATRIX_COL_NUM; col++) {
+            if (MATRIX[row][col] == key_index) {
+                if (pressed) {
+                    m_keys[col] |= 1UL << row;
+                } else {
+                    m_keys[col] &= ~(1UL << row);
+                }
+                return;
+            }
+        }
+    }
+
+    CHECK(!"key index not in MATRIX");
+}
+
+// Scans until an event comes out, returns the scans it took, 0 if none within limit.
+static int scans_to_event(int limit, key_event_t *p_event) {
+    for (int i = 1; i <= limit; i++) {
+        scan();
+
+        if (key_event_get(p_event)) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+static void scans_run(int scans) {
+    for (int i = 0; i < scans; i++) {
+        scan();
+    }
+}
+
+static void settle(void) {
+    key_event_t event;
+
+    scans_run(2 * (PRESS_SCANS + RELEASE_SCANS));
+
+    CHECK(!key_event_get(&event));
+    CHECK(matrix_is_settled());
+}
+
+static void engine_init(void) {
+    matrix_init_t init = {0};
+
+    init.p_backend = &FAKE_BACKEND;
+    init.pass_done_handler = pass_done_handler;
+    init.evt_handler = evt_handler;
+    init.timestamp_get = timestamp_get;
+
+    memset(m_keys, 0, sizeof(m_keys));
+    m_now = 0;
+    m_keys_changed = 0;
+
+    matrix_init(&init);
+}
+
+static void check_press_release(void) {
+    key_event_t event;
+    int8_t key = MATRIX[2][3];
+
+    engine_init();
+    CHECK(matrix_is_idle());
+
+    key_set(key, true);
+
+    int scans = scans_to_event(PRESS_SCANS + 2, &event);
+
+    CHECK(scans >= 1);
+    CHECK(event.key_index == key && event.pressed);
+    CHECK(event.timestamp == (uint32_t)(scans - 1));
+    CHECK(m_keys_changed == 1);
+
+    settle();
+    CHECK(!matrix_is_idle());
+
+    key_set(key, false);
+
+    CHECK(scans_to_event(RELEASE_SCANS + 2, &event) >= 1);
+    CHECK(event.key_index == key && !event.pressed);
+
+    settle();
+    CHECK(matrix_is_idle());
+    CHECK(m_keys_changed == 2);
+}
+
+// Contact bounce within a window gives one press, and no release while the key is held.
+static void check_bounce(void) {
+    key_event_t event;
+    int8_t key = MATRIX[0][0];
+    int presses = 0;
+
+    engine_init();
+
+    for (int i = 0; i < BOUNCE_SCANS; i++) {
+        key_set(key, i % 2 == 0);
+        scan();
+    }
+
+    key_set(key, true);
+    scans_run(2 * (PRESS_SCANS + RELEASE_SCANS));
+
+    while (key_event_get(&event)) {
+        CHECK(event.key_index == key && event.pressed);
+        presses++;
+    }
+
+    CHECK(presses == 1);
+}
+
+// Keys that change in one pass come out in column then row order, with the time stamp of that pass.
+static void check_same_pass(void) {
+    key_event_t events[3];
+    int8_t keys[3] = {MATRIX[3][1], MATRIX[0][4], MATRIX[2][4]};
+
+    engine_init();
+
+    key_set(keys[2], true);
+    key_set(keys[1], true);
+    key_set(keys[0], true);
+
+    CHECK(scans_to_event(PRESS_SCANS + 2, &events[0]) >= 1);
+    CHECK(key_event_get(&events[1]) && key_event_get(&events[2]));
+    CHECK(m_keys_changed == 1);
+
+    for (int i = 0; i < 3; i++) {
+        CHECK(events[i].key_index == keys[i] && events[i].pressed);
+        CHECK(events[i].timestamp == events[0].timestamp);
+    }
+}
+
+// Events nobody takes fill the queue, the rest are dropped and counted.
+static void check_queue_full(void) {
+    int8_t key = MATRIX[1][1];
+    int events = 0;
+    key_event_t event;
+
+    engine_init();
+
+    for (int i = 0; i < KEY_EVENT_QUEUE_SIZE + 4; i++) {
+        key_set(key, true);
+        scans_run(2 * PRESS_SCANS);
+        key_set(key, false);
+        scans_run(2 * RELEASE_SCANS);
+    }
+
+    while (key_event_get(&event)) {
+        CHECK(event.pressed == (events % 2 == 0));
+        events++;
+    }
+
+    CHECK(events == KEY_EVENT_QUEUE_SIZE);
+    CHECK(key_event_dropped_get() == 2 * (KEY_EVENT_QUEUE_SIZE + 4) - KEY_EVENT_QUEUE_SIZE);
+}
+
+int main(void) {
+    check_press_release();
+    check_bounce();
+    check_same_pass();
+    check_queue_full();
+
+    printf("ok\n");
+
+    return 0;
+}
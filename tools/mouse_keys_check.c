@@ -0,0 +1,241 @@
+/*
+ * Mouse keys checks, runs on the host.
+ * A fake 24-bit clock of 32768 Hz stands for the RTC. Holds move keys and checks the motion of every report against
+ * the acceleration curve: speed at press, the curve on the way to full speed, full speed, a tap, motion beyond one
+ * report carried to the next, the wheel, and a clock wrap while a key is held.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o mouse_keys_check tools/mouse_keys_check.c src/mouse_keys/mouse_keys.c -lm
+ * ./mouse_keys_check
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "firmware_config.h"
+#include "keycodes.h"
+#include "mouse_keys/mouse_keys.h"
+#include "port/port.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define TICKS_HZ   32768
+#define TICKS_MASK 0x00FFFFFF
+#define TICK_MS    8 // Time between motion ticks, about one connection interval.
+
+static uint32_t m_now;
+
+static uint32_t ticks_get(uint32_t ms) {
+    return (uint64_t)ms * TICKS_HZ / 1000;
+}
+
+static void start(uint32_t now) {
+    mouse_keys_init_t init = {ticks_get};
+
+    mouse_keys_init(&init);
+    m_now = now;
+}
+
+static void key(uint32_t code, bool pressed) {
+    mouse_keys_key(code, pressed, m_now);
+}
+
+// Ticks every TICK_MS for ms.
+static void hold(uint32_t ms) {
+    uint32_t ticks = ticks_get(ms);
+
+    for (uint32_t t = 0; t < ticks; t += ticks_get(TICK_MS)) {
+        m_now = (m_now + MIN(ticks_get(TICK_MS), ticks - t)) & TICKS_MASK;
+        mouse_keys_tick(m_now);
+    }
+}
+
+// Takes reports until there is no motion left, each within one report. Adds up the motion of all of them.
+static int reports_take(int *p_x, int *p_y, int *p_wheel) {
+    uint8_t report[MOUSE_REPORT_LEN];
+    int reports = 0;
+
+    *p_x = 0;
+    *p_y = 0;
+    *p_wheel = 0;
+
+    while (mouse_keys_report_take(report)) {
+        CHECK((int8_t)report[1] != -128 && (int8_t)report[2] != -128 && (int8_t)report[3] != -128);
+
+        *p_x += (int8_t)report[1];
+        *p_y += (int8_t)report[2];
+        *p_wheel += (int8_t)report[3];
+        reports++;
+    }
+
+    return reports;
+}
+
+// Counts moved while held from held_ms for ms, as the curve gives them.
+static double curve_counts(double held_ms, double ms) {
+    double counts = 0;
+
+    for (double t = held_ms; t < held_ms + ms; t += 0.1) {
+        double ratio = MIN(t / MOUSE_KEYS_TIME_TO_MAX, 1.0);
+        double speed = MOUSE_KEYS_SPEED_MIN + (MOUSE_KEYS_SPEED_MAX - MOUSE_KEYS_SPEED_MIN) * pow(ratio, MOUSE_KEYS_CURVE);
+
+        counts += speed * 0.1 / 1000;
+    }
+
+    return counts;
+}
+
+// Motion of the curve, within a count and 3% for the fixed point steps of the curve.
+static bool near(int counts, double expected) {
+    return fabs(counts - expected) <= 1 + expected * 0.03;
+}
+
+// A press and release at once moves by one count.
+static void check_tap(void) {
+    int x, y, wheel;
+
+    start(1000);
+
+    key(KC_MS_RIGHT, true);
+    key(KC_MS_RIGHT, false);
+    CHECK(reports_take(&x, &y, &wheel) == 1);
+    CHECK(x == 1 && y == 0 && wheel == 0);
+    CHECK(!mouse_keys_is_active());
+
+    key(KC_MS_UP, true);
+    key(KC_MS_UP, false);
+    CHECK(reports_take(&x, &y, &wheel) == 1);
+    CHECK(x == 0 && y == -1);
+}
+
+// Speed starts at the minimum and follows the curve up to the maximum.
+static void check_curve(void) {
+    int x, y, wheel;
+    int half = MOUSE_KEYS_TIME_TO_MAX / 2;
+
+    start(1000);
+
+    key(KC_MS_LEFT, true);
+    CHECK(reports_take(&x, &y, &wheel) == 1);
+    CHECK(x == -1);
+
+    hold(100);
+    reports_take(&x, &y, &wheel);
+    CHECK(near(-x, curve_counts(0, 100)));
+    CHECK(-x <= MOUSE_KEYS_SPEED_MIN * 2 / 10);
+
+    hold(half - 100);
+    reports_take(&x, &y, &wheel);
+    CHECK(near(-x, curve_counts(100, half - 100)));
+
+    hold(MOUSE_KEYS_TIME_TO_MAX - half);
+    reports_take(&x, &y, &wheel);
+    CHECK(near(-x, curve_counts(half, MOUSE_KEYS_TIME_TO_MAX - half)));
+
+    // Full speed from here on.
+    hold(1000);
+    reports_take(&x, &y, &wheel);
+    CHECK(near(-x, MOUSE_KEYS_SPEED_MAX));
+
+    key(KC_MS_LEFT, false);
+    CHECK(!mouse_keys_is_active());
+}
+
+// Motion made while no report is taken goes out in the next ones, at most 127 counts each.
+static void check_carry(void) {
+    int x, y, wheel;
+
+    start(1000);
+
+    key(KC_MS_DOWN, true);
+    hold(MOUSE_KEYS_TIME_TO_MAX + 1000);
+    key(KC_MS_DOWN, false);
+
+    int expected = 1 + (int)curve_counts(0, MOUSE_KEYS_TIME_TO_MAX + 1000);
+
+    CHECK(mouse_keys_is_active());
+    CHECK(reports_take(&x, &y, &wheel) >= expected / 127);
+    CHECK(x == 0 && near(y, expected));
+    CHECK(!mouse_keys_is_active());
+}
+
+// Wheel keys move at their own speed, with no curve.
+static void check_wheel(void) {
+    int x, y, wheel;
+
+    start(1000);
+
+    key(KC_MS_WH_UP, true);
+    hold(1000);
+    key(KC_MS_WH_UP, false);
+
+    reports_take(&x, &y, &wheel);
+    CHECK(x == 0 && y == 0);
+    CHECK(wheel == 1 + MOUSE_KEYS_WHEEL_SPEED);
+
+    key(KC_MS_WH_DOWN, true);
+    key(KC_MS_WH_DOWN, false);
+    reports_take(&x, &y, &wheel);
+    CHECK(wheel == -1);
+}
+
+// Motion is the same when the 24-bit clock wraps while a key is held.
+static void check_wrap(void) {
+    int x, y, wheel;
+    int plain;
+
+    start(1000);
+    key(KC_MS_RIGHT, true);
+    hold(MOUSE_KEYS_TIME_TO_MAX);
+    key(KC_MS_RIGHT, false);
+    reports_take(&plain, &y, &wheel);
+
+    start(TICKS_MASK - ticks_get(MOUSE_KEYS_TIME_TO_MAX / 2));
+    key(KC_MS_RIGHT, true);
+    hold(MOUSE_KEYS_TIME_TO_MAX);
+    key(KC_MS_RIGHT, false);
+    CHECK(m_now < ticks_get(MOUSE_KEYS_TIME_TO_MAX));
+    reports_take(&x, &y, &wheel);
+
+    CHECK(x == plain);
+}
+
+// A button change is reported once, with no motion.
+static void check_buttons(void) {
+    uint8_t report[MOUSE_REPORT_LEN];
+
+    start(1000);
+
+    key(KC_MS_BTN1, true);
+    CHECK(mouse_keys_buttons_changed());
+    CHECK(!mouse_keys_is_active());
+    CHECK(mouse_keys_report_take(report));
+    CHECK(report[0] == 1 && report[1] == 0 && report[2] == 0 && report[3] == 0);
+    CHECK(!mouse_keys_report_take(report));
+
+    key(KC_MS_BTN1, false);
+    CHECK(mouse_keys_report_take(report));
+    CHECK(report[0] == 0);
+}
+
+int main(void) {
+    check_tap();
+    check_curve();
+    check_carry();
+    check_wheel();
+    check_wrap();
+    check_buttons();
+
+    printf("ok\n");
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * Pending report checks, runs on the host.
+ * Keystrokes are typed while the link is down, with the times of the uptime clock on a fake 24 bit counter at
+ * 32768 Hz. Between keystrokes rows wait on sense, where only the UPTIME_READ_INTERVAL timer reads the clock.
+ * Reports held while the link is up never expire, and a full buffer keeps its oldest ones.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o pending_report_check tools/pending_report_check.c \
+ *    src/pending_report/pending_report.c src/uptime/uptime.c
+ * ./pending_report_check
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "firmware_config.h"
+#include "pending_report/pending_report.h"
+#include "uptime/uptime.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define COUNTER_HZ 32768
+
+#define KEY_A 0x04
+
+static uint64_t m_counter; // Counter ticks since the start, the fake RTC reads the low 24 bits.
+
+static uint32_t counter_get(void) {
+    return (uint32_t)m_counter & UPTIME_COUNTER_MASK;
+}
+
+static void reset(void) {
+    uptime_init_t init = {0};
+
+    // Start close to a counter wrap, so the first pause runs across it.
+    m_counter = UPTIME_COUNTER_MASK - COUNTER_HZ;
+    init.counter_get = counter_get;
+    init.counter_hz = COUNTER_HZ;
+
+    uptime_init(&init);
+    pending_report_init();
+}
+
+// Scanning while a key changes, the clock is read every scan.
+static void scan(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i += SCAN_DELAY) {
+        m_counter += (uint64_t)SCAN_DELAY * COUNTER_HZ / 1000;
+        uptime_ms_get();
+    }
+}
+
+// Rows wait on sense, the clock is only read by the timer.
+static void sense_wait(uint32_t ms) {
+    uint64_t end = m_counter + (uint64_t)ms * COUNTER_HZ / 1000;
+    uint64_t step = (uint64_t)UPTIME_READ_INTERVAL * COUNTER_HZ / 1000;
+
+    while (m_counter + step < end) {
+        m_counter += step;
+        uptime_ms_get();
+    }
+
+    m_counter = end;
+}
+
+// A press and a release of key, reports as main_master makes them while the link is down.
+static void keystroke(uint8_t key) {
+    hid_report_t report = {0};
+
+    report.type = HID_TYPE_KB_REPORT;
+    report.data.kb[2] = key;
+    pending_report_put(&report, uptime_ms_get());
+    scan(60);
+
+    report.data.kb[2] = 0;
+    pending_report_put(&report, uptime_ms_get());
+    scan(40);
+}
+
+// Next pending report must be a press or release of key.
+static void expect(uint8_t key, bool pressed) {
+    hid_report_t const *p_report = pending_report_peek();
+
+    CHECK(p_report != NULL);
+    CHECK(p_report->type == HID_TYPE_KB_REPORT);
+    CHECK(p_report->data.kb[2] == (pressed ? key : 0));
+
+    pending_report_pop();
+}
+
+// A short sense wait between keystrokes keeps both, in order. The release of the first key goes with the next press.
+static void check_short_pause(void) {
+    reset();
+
+    keystroke(KEY_A);
+    sense_wait(PENDING_REPORT_MAX_AGE / 2);
+    keystroke(KEY_A + 1);
+
+    pending_report_expire(uptime_ms_get());
+    CHECK(pending_report_count() == 3);
+    expect(KEY_A, true);
+    expect(KEY_A + 1, true);
+    expect(KEY_A + 1, false);
+    CHECK(pending_report_peek() == NULL);
+}
+
+// A release of the key the newest report pressed is kept apart, so the press is seen.
+static void check_tap(void) {
+    reset();
+
+    keystroke(KEY_A);
+    keystroke(KEY_A);
+
+    CHECK(pending_report_count() == 4);
+    expect(KEY_A, true);
+    expect(KEY_A, false);
+    expect(KEY_A, true);
+    expect(KEY_A, false);
+}
+
+// A sense wait longer than PENDING_REPORT_MAX_AGE drops the keystroke before it and only that one.
+static void check_long_pause(void) {
+    reset();
+
+    keystroke(KEY_A);
+    sense_wait(PENDING_REPORT_MAX_AGE + 1000);
+    keystroke(KEY_A + 1);
+
+    CHECK(pending_report_count() == 2);
+    expect(KEY_A + 1, true);
+    expect(KEY_A + 1, false);
+}
+
+// After a sense wait of a whole number of counter wraps the counter reads as it did before. The keystroke before
+// must still expire, and the one after must still be kept.
+static void check_counter_wrap_pause(void) {
+    reset();
+
+    keystroke(KEY_A);
+    sense_wait((uint32_t)(2ULL * (UPTIME_COUNTER_MASK + 1) * 1000 / COUNTER_HZ));
+    keystroke(KEY_A + 1);
+
+    CHECK(pending_report_count() == 2);
+    expect(KEY_A + 1, true);
+    expect(KEY_A + 1, false);
+}
+
+// Reports left from before a long sense wait are dropped when the link comes up, without a new keystroke.
+static void check_link_up_after_pause(void) {
+    reset();
+
+    keystroke(KEY_A);
+    sense_wait(10 * 60 * 1000);
+
+    pending_report_expire(uptime_ms_get());
+    CHECK(pending_report_count() == 0);
+    CHECK(pending_report_peek() == NULL);
+}
+
+// A full buffer drops the oldest reports while the link is down, one keystroke more drops the first two presses.
+// Keystrokes come fast, so none is old enough to expire.
+static void check_full(void) {
+    hid_report_t report = {0};
+
+    reset();
+    report.type = HID_TYPE_KB_REPORT;
+
+    for (int i = 0; i < PENDING_REPORT_NUM + 1; i++) {
+        report.data.kb[2] = KEY_A + i;
+        pending_report_put(&report, uptime_ms_get());
+        scan(20);
+
+        report.data.kb[2] = 0;
+        pending_report_put(&report, uptime_ms_get());
+        scan(20);
+    }
+
+    CHECK(pending_report_count() == PENDING_REPORT_NUM);
+
+    for (int i = 2; i < PENDING_REPORT_NUM + 1; i++) {
+        expect(KEY_A + i, true);
+    }
+
+    expect(KEY_A + PENDING_REPORT_NUM, false);
+}
+
+static void nkro_hold(uint8_t keys) {
+    hid_report_t report = {0};
+
+    report.type = HID_TYPE_NKRO_REPORT;
+
+    for (uint8_t key = KEY_A; key < KEY_A + keys; key++) {
+        report.data.nkro[1 + key / 8] |= 1U << (key % 8);
+    }
+
+    pending_report_hold(&report);
+}
+
+// NKRO report of the next pending report must hold keys from KEY_A on.
+static void expect_nkro(uint8_t keys) {
+    hid_report_t const *p_report = pending_report_peek();
+
+    CHECK(p_report != NULL);
+    CHECK(p_report->type == HID_TYPE_NKRO_REPORT);
+
+    for (uint8_t key = 0; key < NKRO_USAGE_MAX; key++) {
+        bool down = (p_report->data.nkro[1 + key / 8] & (1U << (key % 8))) != 0;
+
+        CHECK(down == (key >= KEY_A && key < KEY_A + keys));
+    }
+
+    pending_report_pop();
+}
+
+// Reports held while the link is up never expire. A full buffer keeps its oldest ones, the newest takes the keys as
+// they stand.
+static void check_hold_full(void) {
+    reset();
+
+    for (int keys = 1; keys <= PENDING_REPORT_NUM + 1; keys++) {
+        nkro_hold(keys);
+    }
+
+    sense_wait(PENDING_REPORT_MAX_AGE + 1000);
+    pending_report_expire(uptime_ms_get());
+    CHECK(pending_report_count() == PENDING_REPORT_NUM);
+
+    for (int keys = 1; keys < PENDING_REPORT_NUM; keys++) {
+        expect_nkro(keys);
+    }
+
+    expect_nkro(PENDING_REPORT_NUM + 1);
+    CHECK(pending_report_peek() == NULL);
+}
+
+int main(void) {
+    check_short_pause();
+    check_tap();
+    check_long_pause();
+    check_counter_wrap_pause();
+    check_link_up_after_pause();
+    check_full();
+    check_hold_full();
+
+    printf("ok\n");
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Report state checks, runs on the host.
+ * Presses and releases consumer and system usages by hand and checks the reports taken after each change: several
+ * consumer usages at once, usages held by two keys, a usage left out while every slot is taken, and reports only
+ * taken when they changed.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o report_state_check tools/report_state_check.c src/report_state/report_state.c
+ * ./report_state_check
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "firmware_config.h"
+#include "keycodes.h"
+#include "report_state/report_state.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define MUTE     0x00E2
+#define VOL_UP   0x00E9
+#define VOL_DOWN 0x00EA
+#define CALC     0x0192 // AL Calculator, above the old 8-bit usage range.
+
+// Next consumer report must hold the usages, in slot order, 0 for a free slot.
+static void expect_cc(uint16_t first, uint16_t second, uint16_t third) {
+    uint16_t usages[CC_USAGE_SLOTS];
+
+    CHECK(report_state_cc_take(usages));
+    CHECK(usages[0] == first && usages[1] == second && usages[2] == third);
+}
+
+static void expect_no_cc(void) {
+    uint16_t usages[CC_USAGE_SLOTS];
+
+    CHECK(!report_state_cc_take(usages));
+}
+
+// Held usages go out together, each in its own slot, and a freed slot is taken by the next usage.
+static void check_consumer_slots(void) {
+    report_state_init();
+
+    report_state_consumer(VOL_UP, true);
+    report_state_consumer(MUTE, true);
+    expect_cc(VOL_UP, MUTE, 0);
+
+    report_state_consumer(CALC, true);
+    expect_cc(VOL_UP, MUTE, CALC);
+
+    report_state_consumer(VOL_UP, false);
+    expect_cc(0, MUTE, CALC);
+
+    report_state_consumer(VOL_DOWN, true);
+    expect_cc(VOL_DOWN, MUTE, CALC);
+
+    report_state_consumer(VOL_DOWN, false);
+    report_state_consumer(MUTE, false);
+    report_state_consumer(CALC, false);
+    expect_cc(0, 0, 0);
+    expect_no_cc();
+}
+
+// Two keys holding the same usage keep it down until both are released.
+static void check_consumer_holders(void) {
+    report_state_init();
+
+    report_state_consumer(MUTE, true);
+    report_state_consumer(MUTE, true);
+    expect_cc(MUTE, 0, 0);
+
+    report_state_consumer(MUTE, false);
+    expect_no_cc();
+
+    report_state_consumer(MUTE, false);
+    expect_cc(0, 0, 0);
+}
+
+// A usage pressed while every slot is taken is left out, and its release changes nothing.
+static void check_consumer_full(void) {
+    report_state_init();
+
+    report_state_consumer(VOL_UP, true);
+    report_state_consumer(VOL_DOWN, true);
+    report_state_consumer(MUTE, true);
+    expect_cc(VOL_UP, VOL_DOWN, MUTE);
+
+    report_state_consumer(CALC, true);
+    expect_no_cc();
+
+    report_state_consumer(CALC, false);
+    expect_no_cc();
+
+    report_state_consumer(VOL_DOWN, false);
+    expect_cc(VOL_UP, 0, MUTE);
+}
+
+// A change undone before the report is taken sends nothing.
+static void check_consumer_undone(void) {
+    report_state_init();
+
+    report_state_consumer(MUTE, true);
+    report_state_consumer(MUTE, false);
+    expect_no_cc();
+
+    report_state_consumer(0, true);
+    expect_no_cc();
+}
+
+// One system usage at a time, the last pressed wins and only its release clears the report.
+static void check_system(void) {
+    uint8_t usage;
+
+    report_state_init();
+
+    report_state_system(SYSTEM_CODE(KC_SYSTEM_SLEEP), true);
+    CHECK(report_state_system_take(&usage));
+    CHECK(usage == 0x82);
+    CHECK(!report_state_system_take(&usage));
+
+    report_state_system(SYSTEM_CODE(KC_SYSTEM_POWER), true);
+    CHECK(report_state_system_take(&usage));
+    CHECK(usage == 0x81);
+
+    report_state_system(SYSTEM_CODE(KC_SYSTEM_SLEEP), false);
+    CHECK(!report_state_system_take(&usage));
+
+    report_state_system(SYSTEM_CODE(KC_SYSTEM_POWER), false);
+    CHECK(report_state_system_take(&usage));
+    CHECK(usage == 0);
+
+    report_state_system(SYSTEM_CODE(KC_SYSTEM_WAKE), true);
+    report_state_system(SYSTEM_CODE(KC_SYSTEM_WAKE), false);
+    CHECK(!report_state_system_take(&usage));
+}
+
+int main(void) {
+    check_consumer_slots();
+    check_consumer_holders();
+    check_consumer_full();
+    check_consumer_undone();
+    check_system();
+
+    printf("ok\n");
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Key to air latency model, runs on the host.
+ * Presses land at random times between free running scans. A scan detects the press, the report is ready a strobe
+ * pass and processing later and goes out at the first connection event after that. With SCAN_RADIO_SYNC, a scan also
+ * starts SCAN_RADIO_SYNC_DISTANCE before every connection event. Prints the latency distribution of both modes for
+ * every scan tier period.
+ *
+ * Build and run from the project folder:
+ * cc -o scan_latency_model tools/scan_latency_model.c
+ * ./scan_latency_model [conn interval in us] [sync distance in us]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CONN_INTERVAL_US  7500
+#define SYNC_DISTANCE_US  1740 // NRF_RADIO_NOTIFICATION_DISTANCE_1740US.
+#define PASS_US           (7 * 100 + 300) // MATRIX_COL_NUM columns of PIN_SET_DELAY, then key processing.
+#define PRESS_NUM         100000
+#define SPAN_US           10000000 // Presses are spread over this time, far longer than any period.
+
+static const uint32_t SCAN_PERIODS_US[] = {1000, 2000, 5000, 10000}; // SCAN_TIER_PERIODS.
+
+static uint32_t m_seed = 0x2545F491;
+static uint32_t m_latencies[PRESS_NUM];
+
+static uint32_t random_get(uint32_t limit) {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    return m_seed % limit;
+}
+
+// First time at or after t of a grid with period and phase.
+static uint64_t next_on_grid(uint64_t t, uint32_t period, uint32_t phase) {
+    if (t <= phase) {
+        return phase;
+    }
+
+    return phase + (t - phase + period - 1) / period * period;
+}
+
+static int compare(void const *p_a, void const *p_b) {
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static void print_row(char const *p_mode, uint32_t period) {
+    uint64_t sum = 0;
+
+    qsort(m_latencies, PRESS_NUM, sizeof(m_latencies[0]), compare);
+
+    for (int i = 0; i < PRESS_NUM; i++) {
+        sum += m_latencies[i];
+    }
+
+    printf("%-6s %6.1f %7.2f %7.2f %7.2f %7.2f %7.2f\n", p_mode, period / 1000.0, sum / (double)PRESS_NUM / 1000.0,
+           m_latencies[PRESS_NUM / 2] / 1000.0, m_latencies[PRESS_NUM * 9 / 10] / 1000.0,
+           m_latencies[PRESS_NUM * 99 / 100] / 1000.0, m_latencies[PRESS_NUM - 1] / 1000.0);
+}
+
+static void model_run(uint32_t interval, uint32_t distance, uint32_t period, int synced) {
+    for (int i = 0; i < PRESS_NUM; i++) {
+        // Scan timer and connection events drift apart, so each press gets its own phase.
+        uint32_t phase = random_get(period);
+        uint64_t press = interval + random_get(SPAN_US);
+        uint64_t scan = next_on_grid(press, period, phase);
+
+        if (synced) {
+            uint64_t sync_scan = next_on_grid(press, interval, interval - distance);
+
+            scan = sync_scan < scan ? sync_scan : scan;
+        }
+
+        m_latencies[i] = next_on_grid(scan + PASS_US, interval, 0) - press;
+    }
+
+    print_row(synced ? "synced" : "timer", period);
+}
+
+int main(int argc, char **argv) {
+    uint32_t interval = argc > 1 ? strtoul(argv[1], NULL, 10) : CONN_INTERVAL_US;
+    uint32_t distance = argc > 2 ? strtoul(argv[2], NULL, 10) : SYNC_DISTANCE_US;
+
+    if (distance >= interval) {
+        fprintf(stderr, "Sync distance must be shorter than the connection interval.\n");
+        return 1;
+    }
+
+    if (distance < PASS_US) {
+        printf("Sync distance is shorter than a pass, synced scans miss the event they lead.\n");
+    }
+
+    printf("Conn interval %.2f ms, sync distance %.2f ms, pass %.2f ms. Latency in ms.\n", interval / 1000.0,
+           distance / 1000.0, PASS_US / 1000.0);
+    printf("mode   period    mean     p50     p90     p99     max\n");
+
+    for (int i = 0; i < (int)(sizeof(SCAN_PERIODS_US) / sizeof(SCAN_PERIODS_US[0])); i++) {
+        model_run(interval, distance, SCAN_PERIODS_US[i], 0);
+        model_run(interval, distance, SCAN_PERIODS_US[i], 1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+/*
+ * Tap hold engine checks, runs on the host.
+ * Key events are made by hand with time stamps of a deterministic clock counting ms, which also stands for the
+ * ticks of the engine. Every decision is checked against the order and codes of the events the engine hands on.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o tap_hold_check tools/tap_hold_check.c src/tap_hold/tap_hold.c
+ * ./tap_hold_check
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "firmware_config.h"
+#include "keycodes.h"
+#include "tap_hold/tap_hold.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define TICKS_MASK 0x00FFFFFF
+
+// Key indexes and their codes.
+#define KEY_MT    1
+#define KEY_LT    2
+#define KEY_B     3
+#define KEY_OTHER 4 // Keys from here on are plain keys.
+
+#define MT_CODE LCTL_T(KC_A)
+#define LT_CODE TAPPING_TERM_SET(LT(1, KC_SPC), 150)
+
+#define LOG_SIZE 64
+
+typedef struct {
+    int8_t key_index;
+    bool pressed;
+    uint32_t code;
+    uint32_t timestamp;
+} log_entry_t;
+
+static log_entry_t m_log[LOG_SIZE];
+static int m_log_count;
+static int m_log_read;
+
+static uint32_t code_get(key_event_t const *p_event) {
+    switch (p_event->key_index) {
+        case KEY_MT:
+            return MT_CODE;
+        case KEY_LT:
+            return LT_CODE;
+        default:
+            return KC_B + p_event->key_index;
+    }
+}
+
+static void evt_handler(key_event_t const *p_event, uint32_t code) {
+    CHECK(m_log_count < LOG_SIZE);
+
+    m_log[m_log_count].key_index = p_event->key_index;
+    m_log[m_log_count].pressed = p_event->pressed;
+    m_log[m_log_count].code = code;
+    m_log[m_log_count].timestamp = p_event->timestamp;
+    m_log_count++;
+}
+
+static uint32_t ticks_get(uint32_t ms) {
+    return ms;
+}
+
+static void engine_init(void) {
+    tap_hold_init_t init = {0};
+
+    init.code_get = code_get;
+    init.evt_handler = evt_handler;
+    init.ticks_get = ticks_get;
+
+    tap_hold_init(&init);
+
+    m_log_count = 0;
+    m_log_read = 0;
+}
+
+static void event(int8_t key_index, bool pressed, uint32_t now) {
+    key_event_t event = {0};
+
+    event.key_index = key_index;
+    event.pressed = pressed;
+    event.timestamp = now & TICKS_MASK;
+
+    tap_hold_event_process(&event);
+}
+
+// Next event handed on must be this one.
+static void expect(int8_t key_index, bool pressed, uint32_t code) {
+    CHECK(m_log_read < m_log_count);
+
+    log_entry_t const *p_entry = &m_log[m_log_read++];
+
+    CHECK(p_entry->key_index == key_index);
+    CHECK(p_entry->pressed == pressed);
+    CHECK(p_entry->code == code);
+}
+
+static void expect_none(void) {
+    CHECK(m_log_read == m_log_count);
+}
+
+static void check_tap(void) {
+    engine_init();
+
+    event(KEY_MT, true, 0);
+    expect_none();
+
+    event(KEY_MT, false, 50);
+    expect(KEY_MT, true, TAP_CODE(MT_CODE));
+    expect(KEY_MT, false, 0);
+    expect_none();
+}
+
+static void check_hold_on_term(void) {
+    uint32_t deadline;
+
+    engine_init();
+
+    event(KEY_MT, true, 100);
+    CHECK(tap_hold_deadline_get(&deadline) && deadline == 100 + TAPPING_TERM);
+
+    tap_hold_tick(100 + TAPPING_TERM - 1);
+    expect_none();
+
+    tap_hold_tick(100 + TAPPING_TERM);
+    expect(KEY_MT, true, HOLD_CODE(MT_CODE));
+    CHECK(!tap_hold_deadline_get(&deadline));
+
+    event(KEY_MT, false, 400);
+    expect(KEY_MT, false, 0);
+    expect_none();
+}
+
+// A key with its own term decides on it and not on TAPPING_TERM.
+static void check_own_term(void) {
+    uint32_t deadline;
+
+    engine_init();
+
+    event(KEY_LT, true, 0);
+    CHECK(tap_hold_deadline_get(&deadline) && deadline == 150);
+
+    tap_hold_tick(149);
+    expect_none();
+
+    tap_hold_tick(150);
+    expect(KEY_LT, true, HOLD_CODE(LT_CODE));
+}
+
+// A queued event after the term is taken as the key being held through it, even before the tick came.
+static void check_event_after_term(void) {
+    engine_init();
+
+    event(KEY_MT, true, 0);
+    event(KEY_B, true, TAPPING_TERM + 10);
+
+    expect(KEY_MT, true, HOLD_CODE(MT_CODE));
+    expect(KEY_B, true, code_get(&(key_event_t){.key_index = KEY_B}));
+    expect_none();
+}
+
+// Another key pressed and released inside the term makes a hold, the events behind come out in order after it.
+static void check_permissive_hold(void) {
+    engine_init();
+
+    event(KEY_MT, true, 0);
+    event(KEY_B, true, 10);
+    expect_none();
+
+    event(KEY_B, false, 30);
+
+#if TAP_HOLD_PERMISSIVE_HOLD || TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS
+    expect(KEY_MT, true, HOLD_CODE(MT_CODE));
+    expect(KEY_B, true, code_get(&(key_event_t){.key_index = KEY_B}));
+    expect(KEY_B, false, 0);
+#endif
+
+    event(KEY_MT, false, 60);
+
+#if !TAP_HOLD_PERMISSIVE_HOLD && !TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS
+    expect(KEY_MT, true, TAP_CODE(MT_CODE));
+    expect(KEY_B, true, code_get(&(key_event_t){.key_index = KEY_B}));
+    expect(KEY_B, false, 0);
+#endif
+
+    expect(KEY_MT, false, 0);
+    expect_none();
+}
+
+// Rolling from a tap hold key into another, releasing the tap hold key first, is a tap.
+static void check_roll_is_tap(void) {
+    engine_init();
+
+    event(KEY_MT, true, 0);
+    event(KEY_B, true, 40);
+
+#if TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS
+    expect(KEY_MT, true, HOLD_CODE(MT_CODE));
+    expect(KEY_B, true, code_get(&(key_event_t){.key_index = KEY_B}));
+#else
+    expect_none();
+
+    event(KEY_MT, false, 60);
+    expect(KEY_MT, true, TAP_CODE(MT_CODE));
+    expect(KEY_B, true, code_get(&(key_event_t){.key_index = KEY_B}));
+    expect(KEY_MT, false, 0);
+
+    event(KEY_B, false, 90);
+    expect(KEY_B, false, 0);
+#endif
+    expect_none();
+}
+
+// A second tap hold key behind an undecided one is decided on its own once it reaches the front.
+static void check_two_tap_hold_keys(void) {
+    engine_init();
+
+    event(KEY_MT, true, 0);
+    event(KEY_LT, true, 20);
+    event(KEY_MT, false, 40);
+
+#if TAP_HOLD_HOLD_ON_OTHER_KEY_PRESS
+    expect(KEY_MT, true, HOLD_CODE(MT_CODE));
+#else
+    expect(KEY_MT, true, TAP_CODE(MT_CODE));
+#endif
+    expect_none();
+
+    // LT got undecided at its own press time, its term runs from there.
+    tap_hold_tick(20 + 149);
+    expect_none();
+
+    tap_hold_tick(20 + 150);
+    expect(KEY_LT, true, HOLD_CODE(LT_CODE));
+    expect(KEY_MT, false, 0);
+    expect_none();
+}
+
+// An event that finds the queue full decides a hold, so nothing is lost.
+static void check_queue_full(void) {
+    engine_init();
+
+    event(KEY_MT, true, 0);
+
+    for (int i = 0; i < TAP_HOLD_QUEUE_SIZE; i++) {
+        event(KEY_OTHER + i, true, 1 + i);
+    }
+
+    expect_none();
+
+    event(KEY_OTHER + TAP_HOLD_QUEUE_SIZE, true, 50);
+    expect(KEY_MT, true, HOLD_CODE(MT_CODE));
+
+    for (int i = 0; i <= TAP_HOLD_QUEUE_SIZE; i++) {
+        expect(KEY_OTHER + i, true, code_get(&(key_event_t){.key_index = KEY_OTHER + i}));
+    }
+
+    expect_none();
+}
+
+// Terms run across the wrap of the 24 bit clock.
+static void check_clock_wrap(void) {
+    uint32_t start = TICKS_MASK - 50;
+    uint32_t deadline;
+
+    engine_init();
+
+    event(KEY_MT, true, start);
+    CHECK(tap_hold_deadline_get(&deadline) && deadline == ((start + TAPPING_TERM) & TICKS_MASK));
+
+    tap_hold_tick((start + TAPPING_TERM - 1) & TICKS_MASK);
+    expect_none();
+
+    tap_hold_tick((start + TAPPING_TERM) & TICKS_MASK);
+    expect(KEY_MT, true, HOLD_CODE(MT_CODE));
+
+    engine_init();
+
+    event(KEY_MT, true, start);
+    event(KEY_MT, false, start + 100);
+    expect(KEY_MT, true, TAP_CODE(MT_CODE));
+    expect(KEY_MT, false, 0);
+}
+
+int main(void) {
+    check_tap();
+    check_hold_on_term();
+    check_own_term();
+    check_event_after_term();
+    check_permissive_hold();
+    check_roll_is_tap();
+    check_two_tap_hold_keys();
+    check_queue_full();
+    check_clock_wrap();
+
+    printf("ok\n");
+
+    return 0;
+}
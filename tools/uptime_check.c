@@ -0,0 +1,104 @@
+/*
+ * Uptime checks, runs on the host.
+ * A fake 24 bit counter at 32768 Hz stands for RTC1. Time goes on in steps, with reads as often as the firmware makes
+ * them: every scan while keys are held, and only the UPTIME_READ_INTERVAL timer while rows wait on sense.
+ *
+ * Build and run from the project folder:
+ * cc -DHOST_BUILD -DMASTER -Isrc -o uptime_check tools/uptime_check.c src/uptime/uptime.c
+ * ./uptime_check
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "firmware_config.h"
+#include "uptime/uptime.h"
+
+#define CHECK(COND)                                                                  \
+    do {                                                                             \
+        if (!(COND)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+            exit(1);                                                                 \
+        }                                                                            \
+    } while (0)
+
+#define COUNTER_HZ 32768
+
+static uint64_t m_counter; // Counter ticks since the start, the fake RTC reads the low 24 bits.
+
+static uint32_t counter_get(void) {
+    return (uint32_t)m_counter & UPTIME_COUNTER_MASK;
+}
+
+static void clock_init(uint32_t start) {
+    uptime_init_t init = {0};
+
+    m_counter = start;
+    init.counter_get = counter_get;
+    init.counter_hz = COUNTER_HZ;
+
+    uptime_init(&init);
+}
+
+// Time goes on by ms, read every step ms.
+static void run(uint64_t ms, uint32_t step) {
+    for (uint64_t done = 0; done < ms; done += step) {
+        m_counter += (uint64_t)step * COUNTER_HZ / 1000;
+        uptime_ms_get();
+    }
+}
+
+static uint32_t ms_of(uint64_t ticks) {
+    return (uint32_t)(ticks * 1000 / COUNTER_HZ);
+}
+
+// Counted time is counter time, whatever the counter read at init.
+static void check_scanning(void) {
+    clock_init(UPTIME_COUNTER_MASK - 1000);
+    CHECK(uptime_ms_get() == 0);
+
+    run(3000, 1);
+    CHECK(uptime_ms_get() == ms_of(m_counter - (UPTIME_COUNTER_MASK - 1000)));
+}
+
+// Rows waiting on sense for five timer reads pass the counter wrap twice. The timer reads keep the count.
+static void check_sense_wait(void) {
+    clock_init(0);
+
+    run(1000, 1);
+    uint32_t before = uptime_ms_get();
+
+    run(5 * UPTIME_READ_INTERVAL, UPTIME_READ_INTERVAL);
+    CHECK(uptime_ms_get() - before == 5 * UPTIME_READ_INTERVAL);
+}
+
+// The read interval sits within one counter wrap, more would lose a wrap.
+static void check_read_interval(void) {
+    CHECK((uint64_t)UPTIME_READ_INTERVAL * COUNTER_HZ / 1000 <= UPTIME_COUNTER_MASK);
+}
+
+// Times less than 49 days apart subtract right across the wrap of the ms count.
+static void check_ms_wrap(void) {
+    uint32_t day = 24 * 60 * 60 * 1000;
+
+    clock_init(0);
+
+    run(49 * (uint64_t)day + day / 2, 60000);
+    uint32_t before = uptime_ms_get();
+
+    run(day, 60000);
+    CHECK(before > UINT32_MAX - day);
+    CHECK(uptime_ms_get() - before == day);
+}
+
+int main(void) {
+    check_scanning();
+    check_sense_wait();
+    check_read_interval();
+    check_ms_wrap();
+
+    printf("ok\n");
+
+    return 0;
+}